@@ -52,6 +52,28 @@ MIT license, all text above must be included in any redistribution.
 #pragma GCC diagnostic ignored "-Wswitch"
 
 
+// SPI clock dividers tried by calibrateSPIClock, from the fastest to the slowest
+#if defined ARDUINO_SAM_DUE
+static const uint8_t calibration_dividers[] = { 2, 3, 4, 5, 6, 7, 8, 10, 12, 14, 16, 21, 28, 42 };
+#elif defined ARDUINO_ARCH_AVR
+static const uint8_t calibration_dividers[] = { SPI_CLOCK_DIV2, SPI_CLOCK_DIV4, SPI_CLOCK_DIV8, SPI_CLOCK_DIV16, SPI_CLOCK_DIV32 };
+#endif
+#define CALIBRATION_DIVIDER_COUNT (sizeof(calibration_dividers) / sizeof(calibration_dividers[0]))
+#define CALIBRATION_PIXEL_COUNT 16	// length of the test pattern (written to the top left corner)
+#define CALIBRATION_REPEATS 4	// how many different patterns have to survive at a clock
+
+#define VSYNC_TIMEOUT 50	// ms, a frame takes about 14ms at the default 70Hz refresh rate
+#define SLPOUT_TIMEOUT 120	// ms, the longest the display takes to leave the sleep mode
+#define RESET_CANCEL_TIME 120	// ms after the reset before SLPOUT is accepted
+
+#define MADCTL_MY  0x80
+#define MADCTL_MX  0x40
+#define MADCTL_MV  0x20
+#define MADCTL_ML  0x10
+#define MADCTL_RGB 0x00
+#define MADCTL_BGR 0x08
+#define MADCTL_MH  0x04
+
 static const uint8_t init_commands[] PROGMEM = {
 	4, 0xEF, 0x03, 0x80, 0x02,
 	4, 0xCF, 0x00, 0XC1, 0X30,
@@ -83,7 +105,9 @@ ILI9341_due::ILI9341_due(uint8_t cs, uint8_t dc, uint8_t rst)
 	_cs = cs;
 	_dc = dc;
 	_rst = rst;
+	_te = 255;
 	_spiClkDivider = ILI9341_SPI_CLKDIVIDER;
+	_spiClkDividerRead = ILI9341_SPI_CLKDIVIDER_READ;
 	_width = ILI9341_TFTWIDTH;
 	_height = ILI9341_TFTHEIGHT;
 	_area.x = 0;
@@ -99,6 +123,25 @@ ILI9341_due::ILI9341_due(uint8_t cs, uint8_t dc, uint8_t rst)
 	_isInTransaction = false;
 #endif
 
+#ifdef ILI_USE_DEFERRED_SPANS
+	_spanCount = 0;
+	_isDeferred = false;
+#endif
+#ifdef ILI_USE_GLYPH_CACHE
+	for (uint8_t i = 0; i < ILI_GLYPH_CACHE_SLOTS; i++)
+		_glyphCache[i].font = NULL;
+	_glyphCacheClock = 0;
+#endif
+#ifdef ILI_USE_STATS
+	_statsPrimitive = iliStatsOther;
+	_statsInCall = false;
+	_statsCommand = false;
+	_statsPixelData = false;
+	_statsCSLow = false;
+	resetStats();
+#endif
+	resetClipRect();
+
 	_fontMode = gTextFontModeSolid;
 	_fontBgColor = ILI9341_BLACK;
 	_fontColor = ILI9341_WHITE;
@@ -108,12 +151,19 @@ ILI9341_due::ILI9341_due(uint8_t cs, uint8_t dc, uint8_t rst)
 	_textScale = 1;
 #endif
 	_isFirstChar = true;
+	_textScroll = false;
+	_scrollHeight = 0;
+	_scrollOffset = 0;
 	setTextArea(0, 0, _width - 1, _height - 1);
 
 }
 
 
-bool ILI9341_due::begin(void)
+// With fastStart, a display that is still running with the settings of this library (e.g. only
+// the MCU was reset by a watchdog) is left as it is, the screen keeps its content. Otherwise the display
+// gets reset and initialized with the minimum delays from the datasheet instead of safe, longer ones.
+// Returns false if the display does not leave the sleep mode (fastStart only, when the display can be read).
+bool ILI9341_due::begin(bool fastStart)
 {
 	if (pinIsChipSelect(_cs)) {
 		pinMode(_dc, OUTPUT);
@@ -135,15 +185,42 @@ bool ILI9341_due::begin(void)
 #endif
 		setSPIClockDivider(ILI9341_SPI_CLKDIVIDER);
 
+		iliRotation rotation;
+		if (fastStart && isInitialized(rotation))
+		{
+			if (_rst < 255) {
+				pinMode(_rst, OUTPUT);
+				digitalWrite(_rst, HIGH);
+			}
+			_isInSleep = _isIdle = false;
+			setRotation(rotation);
+			writeScrollArea();	// the previous program might have left the screen scrolled
+			return true;
+		}
+
 		// toggle RST low to reset
+		bool isReset = false;
+		uint32_t resetTime = 0;
 		if (_rst < 255) {
 			pinMode(_rst, OUTPUT);
 			digitalWrite(_rst, HIGH);
-			delay(5);
-			digitalWrite(_rst, LOW);
-			delay(20);
-			digitalWrite(_rst, HIGH);
-			delay(150);
+			if (fastStart)
+			{
+				digitalWrite(_rst, LOW);
+				delayMicroseconds(20);	// the reset pulse has to be at least 10us long
+				digitalWrite(_rst, HIGH);
+				resetTime = millis();
+				isReset = true;
+				delay(5);	// the display accepts commands 5ms after the reset
+			}
+			else
+			{
+				delay(5);
+				digitalWrite(_rst, LOW);
+				delay(20);
+				digitalWrite(_rst, HIGH);
+				delay(150);
+			}
 		}
 
 		const uint8_t *addr = init_commands;
@@ -156,10 +233,35 @@ bool ILI9341_due::begin(void)
 			}
 		}
 
-		writecommand_last(ILI9341_SLPOUT);    // Exit Sleep
-		delay(120);
+		if (fastStart)
+		{
+			// SLPOUT is ignored until 120ms after the reset, the init commands above were sent in that time
+			const uint32_t sinceReset = millis() - resetTime;
+			if (isReset && sinceReset < RESET_CANCEL_TIME)
+				delay(RESET_CANCEL_TIME - sinceReset);
+			// the init commands set the pixel format, a display without MISO connected reads 0x00 or 0xFF
+			const bool isReadable = readcommand8(ILI9341_RDPIXFMT) == 0x55;
+			writecommand_last(ILI9341_SLPOUT);    // Exit Sleep
+			if (!isReadable)
+				delay(120);
+			else if (!waitForSleepOut())
+			{
+				writecommand_last(ILI9341_SLPOUT);	// sent once more in case the display missed it
+				if (!waitForSleepOut())
+				{
+					endTransaction();
+					return false;
+				}
+			}
+		}
+		else
+		{
+			writecommand_last(ILI9341_SLPOUT);    // Exit Sleep
+			delay(120);
+		}
 		writecommand_last(ILI9341_DISPON);    // Display on
-		delay(120);
+		if (!fastStart)
+			delay(120);
 		_isInSleep = _isIdle = false;
 
 
@@ -176,6 +278,49 @@ bool ILI9341_due::begin(void)
 	}
 }
 
+// Returns true if the display is awake, on and set up the way begin() and setRotation() set it up,
+// rotation is then the rotation it is using. Displays after a power-on or a reset show MADCTL 0 (no BGR).
+bool ILI9341_due::isInitialized(iliRotation &rotation)
+{
+	const uint8_t mode = readcommand8(ILI9341_RDMODE);
+	const uint8_t pixelFormat = readcommand8(ILI9341_RDPIXFMT);
+	const uint8_t madctl = readcommand8(ILI9341_RDMADCTL);
+
+	// booster on, sleep out, normal mode, display on (a missing MISO reads as 0x00 or 0xFF)
+	if (mode == 0xFF || (mode & 0x9C) != 0x9C || pixelFormat != 0x55 || !(madctl & MADCTL_BGR))
+		return false;
+
+	switch (madctl & (MADCTL_MX | MADCTL_MY | MADCTL_MV)) {
+	case MADCTL_MX:
+		rotation = iliRotation0;
+		return true;
+	case MADCTL_MV:
+		rotation = iliRotation90;
+		return true;
+	case MADCTL_MY:
+		rotation = iliRotation180;
+		return true;
+	case MADCTL_MX | MADCTL_MY | MADCTL_MV:
+		rotation = iliRotation270;
+		return true;
+	}
+	return false;
+}
+
+// waits until the display reports that it left the sleep mode and its booster is running,
+// returns false if it did not within SLPOUT_TIMEOUT
+bool ILI9341_due::waitForSleepOut()
+{
+	const uint32_t start = millis();
+	delay(5);	// no command is accepted during the first 5ms after SLPOUT
+	while ((readcommand8(ILI9341_RDMODE) & 0x90) != 0x90)
+	{
+		if (millis() - start > SLPOUT_TIMEOUT)
+			return false;
+	}
+	return true;
+}
+
 bool ILI9341_due::pinIsChipSelect(uint8_t cs)
 {
 #if SPI_MODE_EXTENDED
@@ -245,6 +390,262 @@ void ILI9341_due::getDisplayStatus(void)
 	endTransaction();
 }
 
+// Turns the tearing effect output of the display on or off. The output goes high during the vertical
+// blanking. If te is the pin it is connected to, waitForVBlank watches the pin, otherwise it polls
+// the current scanline over SPI.
+void ILI9341_due::setTearingEffect(boolean enable, uint8_t te)
+{
+	_te = enable ? te : 255;
+	if (_te < 255)
+		pinMode(_te, INPUT);
+
+	beginTransaction();
+	if (enable)
+	{
+		writecommand_cont(ILI9341_TEON);
+		writedata8_last(0x00);	// V-blanking only
+	}
+	else
+	{
+		writecommand_last(ILI9341_TEOFF);
+	}
+	endTransaction();
+}
+
+// returns the line of the panel the display is currently refreshing
+// (rows of GRAM, they go from the bottom of the screen in 180 rotation and are columns in 90 and 270 rotations)
+uint16_t ILI9341_due::getScanline()
+{
+	beginTransaction();
+	writecommand_cont(ILI9341_GETSCAN);
+	beginRead_cont();
+	readdata8_cont(); // dummy read
+	uint16_t line = (read8_cont() & 0x03) << 8;
+	line |= read8_last();
+	endRead_cont();
+	endTransaction();
+	return line;
+}
+
+// Waits until the display starts refreshing a new frame. Anything drawn from the top down right after
+// this returns stays ahead of the refresh and does not tear, as long as it is sent faster than the panel
+// refreshes (about 14ms per frame). Returns false if no frame started within VSYNC_TIMEOUT ms.
+bool ILI9341_due::waitForVBlank()
+{
+	const uint32_t start = millis();
+
+	if (_te < 255)
+	{
+		// wait for the rising edge, a blanking that is already in progress might be almost over
+		while (digitalRead(_te) == HIGH)
+		{
+			if (millis() - start > VSYNC_TIMEOUT)
+				return false;
+		}
+		while (digitalRead(_te) == LOW)
+		{
+			if (millis() - start > VSYNC_TIMEOUT)
+				return false;
+		}
+		return true;
+	}
+
+	// the scanline goes back to 0 when a new frame starts
+	uint16_t previous = getScanline();
+	while (millis() - start <= VSYNC_TIMEOUT)
+	{
+		const uint16_t line = getScanline();
+		if (line < previous)
+			return true;
+		previous = line;
+	}
+	return false;
+}
+
+// Waits until the refresh has passed the given line of the panel (see getScanline). Drawing above
+// that line then does not tear, which lets a large image be sent while the panel refreshes instead
+// of waiting for the blanking. Returns immediately if the refresh is already past the line.
+bool ILI9341_due::waitForScanline(uint16_t line)
+{
+	const uint32_t start = millis();
+	while (getScanline() < line)
+	{
+		if (millis() - start > VSYNC_TIMEOUT)
+			return false;
+	}
+	return true;
+}
+
+#ifdef ILI_USE_STATS
+// sets all counters to 0
+void ILI9341_due::resetStats()
+{
+	memset(_stats, 0, sizeof(_stats));
+#ifdef ARDUINO_SAM_DUE
+	// waitCycles are measured with the cycle counter of the DWT unit
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+// returns the counters summed over all groups of drawing functions
+iliStats ILI9341_due::getTotalStats()
+{
+	iliStats total;
+	memset(&total, 0, sizeof(total));
+	for (uint8_t p = 0; p < iliStatsPrimitiveCount; p++)
+	{
+		total.calls += _stats[p].calls;
+		total.bytes += _stats[p].bytes;
+		total.commandBytes += _stats[p].commandBytes;
+		total.pixelBytes += _stats[p].pixelBytes;
+		total.readBytes += _stats[p].readBytes;
+		total.windowSets += _stats[p].windowSets;
+		total.csToggles += _stats[p].csToggles;
+		total.dcToggles += _stats[p].dcToggles;
+		total.blocks += _stats[p].blocks;
+		total.blockBytes += _stats[p].blockBytes;
+		total.dmaTransfers += _stats[p].dmaTransfers;
+		total.waitCycles += _stats[p].waitCycles;
+	}
+	return total;
+}
+
+// prints the counters of each kind of primitive to Serial
+void ILI9341_due::printStats()
+{
+	const iliBusTiming timing = getBusTiming();
+	Serial.println(F("Primitive  Calls  Bytes  Command  Pixel  Read  Windows  CS  DC  Blocks  DMA  WaitCycles  EstMicros"));
+	for (uint8_t p = 0; p < iliStatsPrimitiveCount; p++)
+	{
+		switch (p) {
+		case iliStatsOther: Serial.print(F("Other")); break;
+		case iliStatsPixel: Serial.print(F("Pixel")); break;
+		case iliStatsLine: Serial.print(F("Line")); break;
+		case iliStatsRect: Serial.print(F("Rect")); break;
+		case iliStatsFillRect: Serial.print(F("FillRect")); break;
+		case iliStatsCircle: Serial.print(F("Circle")); break;
+		case iliStatsFillCircle: Serial.print(F("FillCircle")); break;
+		case iliStatsTriangle: Serial.print(F("Triangle")); break;
+		case iliStatsFillTriangle: Serial.print(F("FillTriangle")); break;
+		case iliStatsRoundRect: Serial.print(F("RoundRect")); break;
+		case iliStatsFillRoundRect: Serial.print(F("FillRoundRect")); break;
+		case iliStatsArc: Serial.print(F("Arc")); break;
+		case iliStatsImage: Serial.print(F("Image")); break;
+		case iliStatsText: Serial.print(F("Text")); break;
+		case iliStatsRead: Serial.print(F("Read")); break;
+		}
+		const iliStats &stats = _stats[p];
+		Serial.print(F("  ")); Serial.print(stats.calls);
+		Serial.print(F("  ")); Serial.print(stats.bytes);
+		Serial.print(F("  ")); Serial.print(stats.commandBytes);
+		Serial.print(F("  ")); Serial.print(stats.pixelBytes);
+		Serial.print(F("  ")); Serial.print(stats.readBytes);
+		Serial.print(F("  ")); Serial.print(stats.windowSets);
+		Serial.print(F("  ")); Serial.print(stats.csToggles);
+		Serial.print(F("  ")); Serial.print(stats.dcToggles);
+		Serial.print(F("  ")); Serial.print(stats.blocks);
+		Serial.print(F("  ")); Serial.print(stats.dmaTransfers);
+		Serial.print(F("  ")); Serial.print(stats.waitCycles);
+		Serial.print(F("  ")); Serial.println(estimateMicros(stats, timing));
+	}
+}
+
+// CPU clock of the board each bus is modelled on, getBusTiming() uses F_CPU instead
+#define DUE_CPU_HZ 84000000
+#define AVR_CPU_HZ 16000000
+
+// returns the timing of the bus the library is compiled for, with the current SPI clock dividers and F_CPU
+iliBusTiming ILI9341_due::getBusTiming()
+{
+#if defined ARDUINO_ARCH_AVR
+	iliBusTiming timing = getBusTiming(iliBusAVR, avrClockDivider(_spiClkDivider), avrClockDivider(_spiClkDividerRead));
+#elif SPI_MODE_NORMAL
+	iliBusTiming timing = getBusTiming(iliBusDueNormal, _spiClkDivider, _spiClkDividerRead);
+#elif SPI_MODE_EXTENDED
+	iliBusTiming timing = getBusTiming(iliBusDueExtended, _spiClkDivider, _spiClkDividerRead);
+#else
+	iliBusTiming timing = getBusTiming(iliBusDueDMA, _spiClkDivider, _spiClkDividerRead);
+#endif
+	timing.cpuHz = F_CPU;	// e.g. 8MHz AVR boards
+	return timing;
+}
+
+// returns the timing of a bus, the dividers are the actual ones (2, 4, 8,...), also for AVR.
+// The CPU clock is the one of a Due or an Uno. The cycle counts are estimates from the code that drives
+// the bus, they are not measured.
+iliBusTiming ILI9341_due::getBusTiming(iliBusType bus, uint8_t divider, uint8_t dividerRead)
+{
+	iliBusTiming timing;
+	timing.divider = divider;
+	timing.dividerRead = dividerRead;
+	timing.cpuHz = DUE_CPU_HZ;
+	timing.dcToggleCycles = 4;
+	timing.csToggleCycles = 8;
+	switch (bus) {
+	case iliBusDueNormal:
+		// SPI.transfer for single bytes, buffers are sent in 16 bit mode polling RDRF between the words
+		timing.byteCycles = 30;
+		timing.blockByteCycles = 4;
+		timing.blockCycles = 20;
+		break;
+	case iliBusDueExtended:
+		// every byte or word goes through SPI.transfer, words switch to 16 bit and back each, CS is driven by the SPI controller
+		timing.byteCycles = 30;
+		timing.blockByteCycles = 20;
+		timing.blockCycles = 10;
+		timing.csToggleCycles = 0;
+		break;
+	case iliBusDueDMA:
+		// single bytes poll RDRF, buffers are one DMA transfer in 16 bit mode (channel setup, waiting for TXEMPTY)
+		timing.byteCycles = 12;
+		timing.blockByteCycles = 0;
+		timing.blockCycles = 120;
+		break;
+	case iliBusAVR:
+		// every byte polls SPIF, loading the next byte overlaps with the transfer only inside buffers
+		timing.cpuHz = AVR_CPU_HZ;
+		timing.byteCycles = 6;
+		timing.blockByteCycles = 2;
+		timing.blockCycles = 4;
+		timing.dcToggleCycles = 6;
+		timing.csToggleCycles = 12;
+		break;
+	}
+	return timing;
+}
+
+// estimates how long the counted traffic takes on the bus, reads are taken as single bytes
+uint32_t ILI9341_due::estimateMicros(const iliStats &stats, const iliBusTiming &timing)
+{
+	const uint32_t writeByte = 8 * (uint32_t)timing.divider;
+	const uint64_t cycles =
+		(uint64_t)(stats.bytes - stats.blockBytes) * (writeByte + timing.byteCycles) +
+		(uint64_t)stats.blockBytes * (writeByte + timing.blockByteCycles) +
+		(uint64_t)stats.blocks * timing.blockCycles +
+		(uint64_t)stats.readBytes * (8 * (uint32_t)timing.dividerRead + timing.byteCycles) +
+		(uint64_t)stats.dcToggles * timing.dcToggleCycles +
+		(uint64_t)stats.csToggles * timing.csToggleCycles;
+	return (uint32_t)(cycles * 1000000 / timing.cpuHz);
+}
+
+#ifdef ARDUINO_ARCH_AVR
+// returns the actual divider of an SPI_CLOCK_DIVx value
+uint8_t ILI9341_due::avrClockDivider(uint8_t clockDiv)
+{
+	switch (clockDiv) {
+	case SPI_CLOCK_DIV2: return 2;
+	case SPI_CLOCK_DIV4: return 4;
+	case SPI_CLOCK_DIV8: return 8;
+	case SPI_CLOCK_DIV16: return 16;
+	case SPI_CLOCK_DIV32: return 32;
+	case SPI_CLOCK_DIV64: return 64;
+	default: return 128;
+	}
+}
+#endif
+#endif
+
 void ILI9341_due::setSPIClockDivider(uint8_t divider)
 {
 	_spiClkDivider = divider;
@@ -289,8 +690,106 @@ void ILI9341_due::setSPIClockDivider(uint8_t divider)
 #endif
 }
 
+// sets the clock divider used while reading from the display (uses the same values as setSPIClockDivider)
+void ILI9341_due::setSPIClockDividerRead(uint8_t divider)
+{
+	_spiClkDividerRead = divider;
+}
+
+// Finds the fastest write and read clocks at which test patterns survive a round trip through GRAM,
+// then picks dividers that are margin steps slower than that. The pixels used for the test are restored.
+// Returns false (and keeps the current dividers) if not even the slowest clock works.
+bool ILI9341_due::calibrateSPIClock(uint8_t margin)
+{
+	const uint8_t initialDivider = _spiClkDivider;
+	const uint8_t initialDividerRead = _spiClkDividerRead;
+	const uint8_t slowest = CALIBRATION_DIVIDER_COUNT - 1;
+	uint16_t saved[CALIBRATION_PIXEL_COUNT];
+	uint16_t pattern[CALIBRATION_PIXEL_COUNT];
+	uint16_t readBack[CALIBRATION_PIXEL_COUNT];
+	uint8_t readId, writeId = CALIBRATION_DIVIDER_COUNT;
+
+	flushDeferred();
+
+	// ILI9341 has no GRAM outside of the screen, the pixels under the test pattern are saved at the slowest clocks
+	setSPIClockDivider(calibration_dividers[slowest]);
+	_spiClkDividerRead = calibration_dividers[slowest];
+	readRect(0, 0, CALIBRATION_PIXEL_COUNT, 1, saved);
+
+	// reads first, the pattern is written at the slowest clock meanwhile
+	for (readId = 0; readId < CALIBRATION_DIVIDER_COUNT; readId++)
+	{
+		_spiClkDividerRead = calibration_dividers[readId];
+		if (testSPIClock(pattern, readBack))
+			break;
+	}
+
+	if (readId < CALIBRATION_DIVIDER_COUNT)
+	{
+		_spiClkDividerRead = calibration_dividers[min(readId + margin, slowest)];
+
+		// then writes, read back at the calibrated read clock
+		for (writeId = 0; writeId < CALIBRATION_DIVIDER_COUNT; writeId++)
+		{
+			setSPIClockDivider(calibration_dividers[writeId]);
+			if (testSPIClock(pattern, readBack))
+				break;
+		}
+	}
+
+	if (readId == CALIBRATION_DIVIDER_COUNT || writeId == CALIBRATION_DIVIDER_COUNT)
+	{
+		Serial.println(F("SPI clock calibration failed"));
+		setSPIClockDivider(calibration_dividers[slowest]);
+		writeCalibrationPixels(saved);
+		setSPIClockDivider(initialDivider);
+		_spiClkDividerRead = initialDividerRead;
+		return false;
+	}
+
+	setSPIClockDivider(calibration_dividers[min(writeId + margin, slowest)]);
+	writeCalibrationPixels(saved);
+	return true;
+}
+
+// writes a few test patterns at the current write clock and reads them back at the current read clock,
+// returns true if all of them came back unchanged
+bool ILI9341_due::testSPIClock(uint16_t *pattern, uint16_t *readBack)
+{
+	uint16_t seed = _spiClkDivider * 251 + _spiClkDividerRead;
+	for (uint8_t r = 0; r < CALIBRATION_REPEATS; r++)
+	{
+		for (uint8_t i = 0; i < CALIBRATION_PIXEL_COUNT; i++)
+		{
+			// every other pixel is the inverse of the previous one, so that every bit toggles
+			seed = seed * 25173 + 13849;
+			pattern[i] = (i & 1) ? ~pattern[i - 1] : seed;
+		}
+		writeCalibrationPixels(pattern);
+		readRect(0, 0, CALIBRATION_PIXEL_COUNT, 1, readBack);
+		for (uint8_t i = 0; i < CALIBRATION_PIXEL_COUNT; i++)
+		{
+			if (readBack[i] != pattern[i])
+				return false;
+		}
+	}
+	return true;
+}
+
+void ILI9341_due::writeCalibrationPixels(uint16_t *colors)
+{
+	beginTransaction();
+	enableCS();
+	setAddrAndRW_cont(0, 0, CALIBRATION_PIXEL_COUNT, 1);
+	setDCForData();
+	write_cont(colors, CALIBRATION_PIXEL_COUNT);
+	disableCS();
+	endTransaction();
+}
+
 void ILI9341_due::setAddrWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
 {
+	flushDeferred();
 	beginTransaction();
 	enableCS();
 	setAddrAndRW_cont(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
@@ -300,6 +799,7 @@ void ILI9341_due::setAddrWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t
 
 void ILI9341_due::setAddrWindowRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
 {
+	flushDeferred();
 	beginTransaction();
 	enableCS();
 	setAddrAndRW_cont(x, y, w, h);
@@ -309,6 +809,8 @@ void ILI9341_due::setAddrWindowRect(uint16_t x, uint16_t y, uint16_t w, uint16_t
 
 void ILI9341_due::pushColor(uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsImage);
+	flushDeferred();
 	beginTransaction();
 	enableCS();
 	setDCForData();
@@ -363,6 +865,8 @@ void ILI9341_due::pushColor(uint16_t color)
 //}
 
 void ILI9341_due::pushColors(const uint16_t *colors, uint16_t offset, uint32_t len) {
+	ILI_STATS_SCOPE(iliStatsImage);
+	flushDeferred();
 	beginTransaction();
 	enableCS();
 	pushColors_noTrans_noCS(colors, offset, len);
@@ -371,6 +875,8 @@ void ILI9341_due::pushColors(const uint16_t *colors, uint16_t offset, uint32_t l
 }
 
 void ILI9341_due::pushColors(uint16_t *colors, uint16_t offset, uint32_t len) {
+	ILI_STATS_SCOPE(iliStatsImage);
+	flushDeferred();
 	beginTransaction();
 	enableCS();
 	setDCForData();
@@ -409,6 +915,7 @@ void ILI9341_due::pushColors_noTrans_noCS(const uint16_t *colors, uint16_t offse
 
 
 void ILI9341_due::drawPixel(int16_t x, int16_t y, uint16_t color) {
+	ILI_STATS_SCOPE(iliStatsPixel);
 	beginTransaction();
 	enableCS();
 	drawPixel_last(x, y, color);
@@ -417,27 +924,361 @@ void ILI9341_due::drawPixel(int16_t x, int16_t y, uint16_t color) {
 }
 
 void ILI9341_due::drawImage(const uint16_t *colors, uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
-	const uint32_t totalPixels = (uint32_t)w*(uint32_t)h;
+	ILI_STATS_SCOPE(iliStatsImage);
+	int16_t cx = x, cy = y, cw = w, ch = h;
+	if (!clipRect(cx, cy, cw, ch)) return;
+
+	flushDeferred();
 	beginTransaction();
 	enableCS();
-	setAddrAndRW_cont(x, y, w, h);
-	pushColors_noTrans_noCS(colors, 0, totalPixels);
+	setAddrAndRW_cont(cx, cy, cw, ch);
+	colors += (uint32_t)(cy - (int16_t)y) * w + (cx - (int16_t)x);	// first visible pixel, x and y may be negative coordinates passed as unsigned
+	if (cw == w) {
+		// whole rows are visible, the pixels are one continuous block
+		pushColors_noTrans_noCS(colors, 0, (uint32_t)cw*(uint32_t)ch);
+	}
+	else {
+		for (int16_t row = 0; row < ch; row++) {
+			pushColors_noTrans_noCS(colors, 0, cw);
+			colors += w;
+		}
+	}
+	disableCS();
+	endTransaction();
+}
+
+// writes one opaque run of a sprite row, the run is trimmed to the clip rectangle
+void ILI9341_due::writeSpriteRun_cont(const uint16_t *colors, int16_t x, int16_t y, int16_t len)
+{
+	const int16_t runX = x;
+	if (!clipHLine(x, y, len)) return;
+
+	setAddrAndRW_cont(x, y, len, 1);
+	pushColors_noTrans_noCS(colors, x - runX, len);
+}
+
+// draws an image in which pixels of transparentColor are left out, whatever is on the screen shows through them
+// only the opaque runs of each row are sent, every run gets its own window
+void ILI9341_due::drawSprite(const uint16_t *colors, int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t transparentColor)
+{
+	ILI_STATS_SCOPE(iliStatsImage);
+	int16_t cx = x, cy = y, cw = w, ch = h;
+	if (!clipRect(cx, cy, cw, ch)) return;
+	const uint16_t i0 = cx - x, i1 = i0 + cw, j0 = cy - y, j1 = j0 + ch;
+
+	flushDeferred();
+	beginTransaction();
+	enableCS();
+	for (uint16_t j = j0; j < j1; j++)
+	{
+		const uint16_t *row = colors + (uint32_t)j * w;
+		uint16_t i = i0;
+		while (i < i1)
+		{
+			// skip the transparent pixels, then look for the end of the opaque run
+			while (i < i1 && pgm_read_word(row + i) == transparentColor) i++;
+			const uint16_t runStart = i;
+			while (i < i1 && pgm_read_word(row + i) != transparentColor) i++;
+			if (i > runStart)
+				writeSpriteRun_cont(row + runStart, x + runStart, y + j, i - runStart);
+		}
+	}
+	disableCS();
+	endTransaction();
+}
+
+// draws an image through a 1-bit mask (same layout as drawBitmap, bit set = pixel is drawn)
+void ILI9341_due::drawMaskedSprite(const uint16_t *colors, int16_t x, int16_t y, uint16_t w, uint16_t h, const uint8_t *mask)
+{
+	ILI_STATS_SCOPE(iliStatsImage);
+	const uint16_t byteWidth = (w + 7) / 8;
+
+	int16_t cx = x, cy = y, cw = w, ch = h;
+	if (!clipRect(cx, cy, cw, ch)) return;
+	const uint16_t i0 = cx - x, i1 = i0 + cw, j0 = cy - y, j1 = j0 + ch;
+
+	flushDeferred();
+	beginTransaction();
+	enableCS();
+	for (uint16_t j = j0; j < j1; j++)
+	{
+		const uint8_t *maskRow = mask + j * byteWidth;
+		uint16_t i = i0;
+		while (i < i1)
+		{
+			while (i < i1 && !(pgm_read_byte(maskRow + i / 8) & (128 >> (i & 7)))) i++;
+			const uint16_t runStart = i;
+			while (i < i1 && (pgm_read_byte(maskRow + i / 8) & (128 >> (i & 7)))) i++;
+			if (i > runStart)
+				writeSpriteRun_cont(colors + (uint32_t)j * w + runStart, x + runStart, y + j, i - runStart);
+		}
+	}
+	disableCS();
+	endTransaction();
+}
+
+// draws an image using a precomputed table of opaque runs (BMP24toILI565 -runs creates it)
+// for each row the table holds the number of runs followed by a start column and a length of each run
+void ILI9341_due::drawSpriteRuns(const uint16_t *colors, int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t *runs)
+{
+	ILI_STATS_SCOPE(iliStatsImage);
+	int16_t cx = x, cy = y, cw = w, ch = h;
+	if (!clipRect(cx, cy, cw, ch)) return;
+	const uint16_t j0 = cy - y, j1 = j0 + ch;
+
+	flushDeferred();
+	beginTransaction();
+	enableCS();
+	for (uint16_t j = 0; j < j1; j++)
+	{
+		const uint16_t runCount = pgm_read_word(runs++);
+		if (j >= j0)
+		{
+			for (uint16_t r = 0; r < runCount; r++)
+			{
+				const uint16_t runStart = pgm_read_word(runs + 2 * r);
+				writeSpriteRun_cont(colors + (uint32_t)j * w + runStart, x + runStart, y + j, pgm_read_word(runs + 2 * r + 1));
+			}
+		}
+		runs += 2 * runCount;
+	}
 	disableCS();
 	endTransaction();
 }
 
+// sends count pixels of an RLE packet, literal pixels are copied, a repeated color is sent from the scanline
+void ILI9341_due::writeRLEPixels_cont(const uint16_t *literal, uint16_t color, uint32_t count)
+{
+	if (literal)
+	{
+		pushColors_noTrans_noCS(literal, 0, count);
+	}
+	else
+	{
+		fillScanline16(color, min(count, SCANLINE_PIXEL_COUNT));
+		setDCForData();
+		writeScanlineLooped(count);
+	}
+}
+
+// draws a run-length encoded image (BMP24toILI565 -rle creates it)
+// the data is a sequence of packets, each starts with a header word:
+//   bit 15 set:   repeat packet, bits 0-14 = number of pixels, the next word is their color
+//   bit 15 clear: literal packet, bits 0-14 = number of pixels, that many colors follow
+// packets run through the rows without a break, a header of 0 ends the data early
+void ILI9341_due::drawImageRLE(const uint16_t *data, int16_t x, int16_t y, uint16_t w, uint16_t h)
+{
+	ILI_STATS_SCOPE(iliStatsImage);
+	int16_t cx = x, cy = y, cw = w, ch = h;
+	if (!clipRect(cx, cy, cw, ch)) return;
+	const uint16_t i0 = cx - x, i1 = i0 + cw;
+	// visible rows as a range of pixel indexes
+	const uint32_t firstPixel = (uint32_t)(cy - y) * w;
+	const uint32_t lastPixel = firstPixel + (uint32_t)ch * w;
+
+	flushDeferred();
+	beginTransaction();
+	enableCS();
+	setAddrAndRW_cont(cx, cy, cw, ch);
+
+	uint32_t pos = 0;
+	while (pos < lastPixel)
+	{
+		const uint16_t header = pgm_read_word(data++);
+		const uint16_t count = header & 0x7FFF;
+		if (count == 0)
+			break;
+
+		const uint16_t *literal = 0;
+		uint16_t color = 0;
+		if (header & 0x8000)
+		{
+			color = pgm_read_word(data++);
+		}
+		else
+		{
+			literal = data;
+			data += count;
+		}
+
+		uint32_t p = max(pos, firstPixel);
+		const uint32_t end = min(pos + count, lastPixel);
+		if (cw == w)
+		{
+			// whole rows are visible, the packet goes out in one piece
+			if (p < end)
+				writeRLEPixels_cont(literal ? literal + (p - pos) : 0, color, end - p);
+		}
+		else
+		{
+			// send only the visible columns of each row the packet covers
+			while (p < end)
+			{
+				const uint16_t col = p % w;
+				const uint32_t rowEnd = min(end, p - col + w);
+				const uint16_t visibleStart = max(col, i0);
+				const uint16_t visibleEnd = min(col + (rowEnd - p), (uint32_t)i1);
+				if (visibleStart < visibleEnd)
+					writeRLEPixels_cont(literal ? literal + (p - pos) + (visibleStart - col) : 0, color, visibleEnd - visibleStart);
+				p = rowEnd;
+			}
+		}
+		pos += count;
+	}
+	disableCS();
+	endTransaction();
+}
+
+// draws an image made of palette indexes (BMP24toILI565 -indexed creates it), bitsPerPixel can be 1, 2, 4 or 8
+// indexes are packed from the most significant bit, each row starts on a new byte
+void ILI9341_due::drawIndexedImage(const uint8_t *indexes, const uint16_t *palette, uint8_t bitsPerPixel, int16_t x, int16_t y, uint16_t w, uint16_t h)
+{
+	ILI_STATS_SCOPE(iliStatsImage);
+	if (bitsPerPixel != 1 && bitsPerPixel != 2 && bitsPerPixel != 4 && bitsPerPixel != 8)
+	{
+		Serial.println(F("Unsupported bits per pixel"));
+		return;
+	}
+
+	int16_t cx = x, cy = y, cw = w, ch = h;
+	if (!clipRect(cx, cy, cw, ch)) return;
+	const uint16_t i0 = cx - x, i1 = i0 + cw, j0 = cy - y, j1 = j0 + ch;
+	const uint16_t bytesPerRow = ((uint32_t)w * bitsPerPixel + 7) / 8;
+	const uint8_t indexMask = (1 << bitsPerPixel) - 1;
+
+	// neighbouring pixels mostly share the index, the palette is read only when it changes
+	int16_t lastIndex = -1;
+	uint16_t color = 0;
+
+	flushDeferred();
+	beginTransaction();
+	enableCS();
+	setAddrAndRW_cont(cx, cy, cw, ch);
+	setDCForData();
+	for (uint16_t j = j0; j < j1; j++)
+	{
+		const uint8_t *row = indexes + (uint32_t)j * bytesPerRow;
+		uint16_t lineId = 0;
+		for (uint16_t i = i0; i < i1; i++)
+		{
+			const uint16_t bitPos = i * bitsPerPixel;
+			const uint8_t index = (pgm_read_byte(row + (bitPos >> 3)) >> (8 - bitsPerPixel - (bitPos & 7))) & indexMask;
+			if (index != lastIndex)
+			{
+				lastIndex = index;
+				color = pgm_read_word(palette + index);
+			}
+			_scanline16[lineId++] = color;
+			if (lineId == SCANLINE_PIXEL_COUNT)
+			{
+				writeScanline16(lineId);
+				lineId = 0;
+			}
+		}
+		if (lineId > 0)
+			writeScanline16(lineId);
+	}
+	disableCS();
+	endTransaction();
+}
+
+// returns the hash the images of a pack are found by (FNV-1a of the name)
+uint32_t ILI9341_due::packHash(const char *name)
+{
+	uint32_t hash = 2166136261UL;
+	while (*name)
+	{
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619UL;
+	}
+	return hash;
+}
+
+// decodes a slot of a pack that was read into RAM (e.g. from an SD card)
+void ILI9341_due::readPackEntry(const uint8_t *slot, iliPackEntry &entry)
+{
+	entry.hash = (uint32_t)slot[0] | ((uint32_t)slot[1] << 8) | ((uint32_t)slot[2] << 16) | ((uint32_t)slot[3] << 24);
+	entry.format = slot[4];
+	entry.bitsPerPixel = slot[5];
+	entry.w = slot[6] | (slot[7] << 8);
+	entry.h = slot[8] | (slot[9] << 8);
+	entry.paletteSize = slot[10] | (slot[11] << 8);
+	entry.offset = (uint32_t)slot[12] | ((uint32_t)slot[13] << 8) | ((uint32_t)slot[14] << 16) | ((uint32_t)slot[15] << 24);
+	entry.size = (uint32_t)slot[16] | ((uint32_t)slot[17] << 8) | ((uint32_t)slot[18] << 16) | ((uint32_t)slot[19] << 24);
+}
+
+// looks up an image in a pack stored in flash, returns false if the pack does not have it
+// the slot the hash points to is checked first, only images whose hashes collide need the next slots
+bool ILI9341_due::getPackEntry(const uint8_t *pack, const char *name, iliPackEntry &entry)
+{
+	if (pgm_read_byte(pack) != 'I' || pgm_read_byte(pack + 1) != 'L' || pgm_read_byte(pack + 2) != 'P' || pgm_read_byte(pack + 3) != 'K')
+		return false;
+	const uint16_t slotCount = pgm_read_byte(pack + 6) | (pgm_read_byte(pack + 7) << 8);
+	const uint32_t hash = packHash(name);
+
+	uint8_t slot[ILI_PACK_SLOT_SIZE];
+	uint16_t s = hash & (slotCount - 1);
+	for (uint16_t probe = 0; probe < slotCount; probe++)
+	{
+		const uint8_t *p = pack + ILI_PACK_HEADER_SIZE + (uint32_t)s * ILI_PACK_SLOT_SIZE;
+		for (uint8_t i = 0; i < ILI_PACK_SLOT_SIZE; i++)
+			slot[i] = pgm_read_byte(p + i);
+		readPackEntry(slot, entry);
+		if (entry.format == iliPackEmpty)
+			return false;
+		if (entry.hash == hash)
+			return true;
+		s = (s + 1) & (slotCount - 1);
+	}
+	return false;
+}
+
+// draws an image of a pack stored in flash with the drawing function of its format
+bool ILI9341_due::drawPackImage(const uint8_t *pack, const char *name, int16_t x, int16_t y)
+{
+	iliPackEntry entry;
+	if (!getPackEntry(pack, name, entry))
+	{
+		Serial.print(F("Image not found in pack: ")); Serial.println(name);
+		return false;
+	}
+
+	const uint8_t *data = pack + entry.offset;
+	switch (entry.format) {
+	case iliPackRaw:
+		drawImage((const uint16_t*)data, x, y, entry.w, entry.h);
+		break;
+	case iliPackRLE:
+		drawImageRLE((const uint16_t*)data, x, y, entry.w, entry.h);
+		break;
+	case iliPackIndexed:
+		drawIndexedImage(data + entry.paletteSize * 2, (const uint16_t*)data, entry.bitsPerPixel, x, y, entry.w, entry.h);
+		break;
+	default:
+		Serial.println(F("Unsupported image format in pack"));
+		return false;
+	}
+	return true;
+}
+
 void ILI9341_due::drawFastVLine(int16_t x, int16_t y, uint16_t h, uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsLine);
 	beginTransaction();
 	drawFastVLine_noTrans(x, y, h, color);
 	endTransaction();
 }
 
-void ILI9341_due::drawFastVLine_noTrans(int16_t x, int16_t y, uint16_t h, uint16_t color)
+void ILI9341_due::drawFastVLine_noTrans(int16_t x, int16_t y, int16_t h, uint16_t color)
 {
-	// Rudimentary clipping
-	if ((x >= _width) || (y >= _height)) return;
-	if ((y + (int16_t)h - 1) >= _height) h = _height - y;
+	if (!clipVLine(x, y, h)) return;
+
+#ifdef ILI_USE_DEFERRED_SPANS
+	if (_isDeferred) {
+		queueSpan(x, y, 1, h, color);
+		return;
+	}
+#endif
 
 	fillScanline16(color, min(h, SCANLINE_PIXEL_COUNT));
 
@@ -468,8 +1309,14 @@ void ILI9341_due::drawFastVLine_cont_noFill(int16_t x, int16_t y, int16_t h, uin
 	//	writeScanline(h);
 	//#endif
 
-	if ((x >= _width) || (y >= _height)) return;
-	if ((y + h - 1) >= _height) h = _height - y;
+	if (!clipVLine(x, y, h)) return;
+
+#ifdef ILI_USE_DEFERRED_SPANS
+	if (_isDeferred) {
+		queueSpan(x, y, 1, h, color);
+		return;
+	}
+#endif
 
 	setAddrAndRW_cont(x, y, 1, h);
 	setDCForData();
@@ -483,17 +1330,22 @@ void ILI9341_due::drawFastVLine_cont_noFill(int16_t x, int16_t y, int16_t h, uin
 
 void ILI9341_due::drawFastHLine(int16_t x, int16_t y, uint16_t w, uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsLine);
 	beginTransaction();
 	drawFastHLine_noTrans(x, y, w, color);
 	endTransaction();
 }
 
-void ILI9341_due::drawFastHLine_noTrans(int16_t x, int16_t y, uint16_t w, uint16_t color)
+void ILI9341_due::drawFastHLine_noTrans(int16_t x, int16_t y, int16_t w, uint16_t color)
 {
-	// Rudimentary clipping
-	if ((x >= _width) || (y >= _height)) return;
-	if ((x + (int16_t)w - 1) >= _width)  w = _width - x;
+	if (!clipHLine(x, y, w)) return;
 
+#ifdef ILI_USE_DEFERRED_SPANS
+	if (_isDeferred) {
+		queueSpan(x, y, w, 1, color);
+		return;
+	}
+#endif
 
 	fillScanline16(color, min(w, SCANLINE_PIXEL_COUNT));
 	enableCS();
@@ -509,7 +1361,24 @@ void ILI9341_due::drawFastHLine_noTrans(int16_t x, int16_t y, uint16_t w, uint16
 
 void ILI9341_due::fillScreen(uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsFillRect);
 	const uint32_t numLoops = (uint32_t)76800 / (uint32_t)SCANLINE_PIXEL_COUNT;
+
+	if (_clip.x1 > 0 || _clip.y1 > 0 || _clip.x2 < _width || _clip.y2 < _height) {
+		// only the clip rectangle gets filled
+		fillRect(_clip.x1, _clip.y1, _clip.x2 - _clip.x1, _clip.y2 - _clip.y1, color);
+		return;
+	}
+
+#ifdef ILI_USE_DEFERRED_SPANS
+	_spanCount = 0;	// everything queued would be overwritten anyway
+#endif
+	if (_scrollOffset > 0)
+	{
+		// the whole screen has the same color now, so the scrolling can start over
+		_scrollOffset = 0;
+		writeScrollArea();
+	}
 	fillScanline16(color);
 
 	beginTransaction();
@@ -528,6 +1397,7 @@ void ILI9341_due::fillScreen(uint16_t color)
 // fill a rectangle
 void ILI9341_due::fillRect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsFillRect);
 	beginTransaction();
 	fillRect_noTrans(x, y, w, h, color);
 	endTransaction();
@@ -535,6 +1405,8 @@ void ILI9341_due::fillRect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_
 
 void ILI9341_due::fillRectWithShader(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t(*fillShader)(uint16_t rx, uint16_t ry))
 {
+	ILI_STATS_SCOPE(iliStatsFillRect);
+	flushDeferred();
 	beginTransaction();
 	fillRectWithShader_noTrans(x, y, w, h, fillShader);
 	endTransaction();
@@ -542,13 +1414,16 @@ void ILI9341_due::fillRectWithShader(int16_t x, int16_t y, uint16_t w, uint16_t
 
 
 // fill a rectangle
-void ILI9341_due::fillRect_noTrans(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t color)
+void ILI9341_due::fillRect_noTrans(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
 {
-	//Serial << "x:" << x << " y:" << y << " w:" << x << " h:" << h << " width:" << _width << " height:" << _height <<endl;
-	// rudimentary clipping (drawChar w/big text requires this)
-	if ((x >= _width) || (y >= _height) || (x + w - 1 < 0) || (y + h - 1 < 0)) return;
-	if ((x + (int16_t)w - 1) >= _width)  w = _width - x;
-	if ((y + (int16_t)h - 1) >= _height) h = _height - y;
+	if (!clipRect(x, y, w, h)) return;
+
+#ifdef ILI_USE_DEFERRED_SPANS
+	if (_isDeferred) {
+		queueSpan(x, y, w, h, color);
+		return;
+	}
+#endif
 
 	const uint32_t totalPixels = (uint32_t)w*(uint32_t)h;
 	fillScanline16(color, min(totalPixels, SCANLINE_PIXEL_COUNT));
@@ -559,13 +1434,12 @@ void ILI9341_due::fillRect_noTrans(int16_t x, int16_t y, uint16_t w, uint16_t h,
 	disableCS();
 }
 
-void ILI9341_due::fillRectWithShader_noTrans(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t(*fillShader)(uint16_t rx, uint16_t ry))
+void ILI9341_due::fillRectWithShader_noTrans(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t(*fillShader)(uint16_t rx, uint16_t ry))
 {
-	//Serial << "x:" << x << " y:" << y << " w:" << x << " h:" << h << " width:" << _width << " height:" << _height <<endl;
-	// rudimentary clipping (drawChar w/big text requires this)
-	if ((x >= _width) || (y >= _height) || (x + w - 1 < 0) || (y + h - 1 < 0)) return;
-	if ((x + (int16_t)w - 1) >= _width)  w = _width - x;
-	if ((y + (int16_t)h - 1) >= _height) h = _height - y;
+	// the shader still gets coordinates relative to the unclipped rectangle
+	const int16_t x0 = x, y0 = y;
+	if (!clipRect(x, y, w, h)) return;
+	const uint16_t offsetX = x - x0, offsetY = y - y0;
 
 	enableCS();
 	setAddrAndRW_cont(x, y, w, h);
@@ -573,23 +1447,206 @@ void ILI9341_due::fillRectWithShader_noTrans(int16_t x, int16_t y, uint16_t w, u
 	for (uint16_t ry = 0; ry < h; ry++) {
 		for (uint16_t rx = 0; rx < w; rx++)
 		{
-			_scanline16[rx] = fillShader(rx, ry);
+			_scanline16[rx] = fillShader(rx + offsetX, ry + offsetY);
 		}
 		writeScanline16(w);
 	}
 	disableCS();
 }
 
-#define MADCTL_MY  0x80
-#define MADCTL_MX  0x40
-#define MADCTL_MV  0x20
-#define MADCTL_ML  0x10
-#define MADCTL_RGB 0x00
-#define MADCTL_BGR 0x08
-#define MADCTL_MH  0x04
+#ifdef ILI_USE_DEFERRED_SPANS
+// returns true if span a has to be placed after span b so that spans which can be joined end up next to each other
+static bool spanAfter(const iliSpan &a, const iliSpan &b, bool vertical)
+{
+	if (a.color != b.color) return a.color > b.color;
+	if (vertical) {
+		if (a.x != b.x) return a.x > b.x;
+		if (a.w != b.w) return a.w > b.w;
+		return a.y > b.y;
+	}
+	else {
+		if (a.y != b.y) return a.y > b.y;
+		if (a.h != b.h) return a.h > b.h;
+		return a.x > b.x;
+	}
+}
+
+// queues a rectangle of one color, the rectangle is clipped to the clip rectangle
+void ILI9341_due::queueSpan(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+	if (!clipRect(x, y, w, h)) return;
+
+	// spans are sorted by color when flushed, so a span covering a queued span
+	// of a different color would end up in the wrong order, send the queue first
+	for (uint16_t i = 0; i < _spanCount; i++)
+	{
+		const iliSpan &s = _spans[i];
+		if (s.color != color &&
+			x < s.x + (int16_t)s.w && s.x < x + w &&
+			y < s.y + (int16_t)s.h && s.y < y + h)
+		{
+			flushDeferred_noTrans();
+			break;
+		}
+	}
+
+	if (_spanCount > 0)
+	{
+		// most primitives emit spans in order, try to extend the last one first
+		iliSpan &last = _spans[_spanCount - 1];
+		if (last.color == color)
+		{
+			if (last.y == y && last.h == h && last.x + (int16_t)last.w == x) {
+				last.w += w;
+				return;
+			}
+			if (last.x == x && last.w == w && last.y + (int16_t)last.h == y) {
+				last.h += h;
+				return;
+			}
+		}
+	}
+
+	if (_spanCount == DEFERRED_SPAN_QUEUE_SIZE)
+		flushDeferred_noTrans();
+
+	iliSpan &s = _spans[_spanCount++];
+	s.x = x;
+	s.y = y;
+	s.w = w;
+	s.h = h;
+	s.color = color;
+}
+
+// sorts the queue and joins spans of the same color that touch or overlap,
+// vertical joins spans with the same x and width, otherwise spans with the same y and height are joined
+void ILI9341_due::mergeSpans(bool vertical)
+{
+	// insertion sort, the queue is short and mostly sorted already
+	for (uint16_t i = 1; i < _spanCount; i++)
+	{
+		const iliSpan s = _spans[i];
+		int16_t j = i - 1;
+		while (j >= 0 && spanAfter(_spans[j], s, vertical)) {
+			_spans[j + 1] = _spans[j];
+			j--;
+		}
+		_spans[j + 1] = s;
+	}
+
+	uint16_t n = 0;
+	for (uint16_t i = 0; i < _spanCount; i++)
+	{
+		const iliSpan &s = _spans[i];
+		if (n > 0)
+		{
+			iliSpan &m = _spans[n - 1];
+			if (vertical && m.color == s.color && m.x == s.x && m.w == s.w && s.y <= m.y + (int16_t)m.h) {
+				m.h = max(m.y + m.h, s.y + s.h) - m.y;
+				continue;
+			}
+			if (!vertical && m.color == s.color && m.y == s.y && m.h == s.h && s.x <= m.x + (int16_t)m.w) {
+				m.w = max(m.x + m.w, s.x + s.w) - m.x;
+				continue;
+			}
+		}
+		_spans[n++] = s;
+	}
+	_spanCount = n;
+}
+
+void ILI9341_due::flushDeferred_noTrans()
+{
+	if (_spanCount == 0)
+		return;
+
+	const uint16_t color = _color;	// a primitive being queued may still rely on the scanline
+
+	mergeSpans(true);
+	mergeSpans(false);
+
+	fillScanline16(_spans[0].color);
+	enableCS();
+	for (uint16_t i = 0; i < _spanCount; i++)
+	{
+		const iliSpan &s = _spans[i];
+		if (s.color != _color)
+			fillScanline16(s.color);
+		setAddrAndRW_cont(s.x, s.y, s.w, s.h);
+		setDCForData();
+		writeScanlineLooped((uint32_t)s.w*(uint32_t)s.h);
+	}
+	disableCS();
+	_spanCount = 0;
+
+	fillScanline16(color);
+}
+#endif
+
+void ILI9341_due::beginDeferred()
+{
+#ifdef ILI_USE_DEFERRED_SPANS
+	_isDeferred = true;
+#endif
+}
+
+void ILI9341_due::endDeferred()
+{
+#ifdef ILI_USE_DEFERRED_SPANS
+	flushDeferred();
+	_isDeferred = false;
+#endif
+}
+
+void ILI9341_due::flushDeferred()
+{
+#ifdef ILI_USE_DEFERRED_SPANS
+	if (_spanCount == 0)
+		return;
+	beginTransaction();
+	flushDeferred_noTrans();
+	endTransaction();
+#endif
+}
+
+void ILI9341_due::pushClipRect(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+	// when the stack is full the clip is still narrowed, only the rectangle to restore is lost
+	if (_clipStackSize == CLIP_STACK_DEPTH)
+		_clipStackOverflow++;
+	else
+		_clipStack[_clipStackSize++] = _clip;
+
+	// the new clip rectangle can only make the current one smaller
+	_clip.x1 = max(_clip.x1, x);
+	_clip.y1 = max(_clip.y1, y);
+	_clip.x2 = min(_clip.x2, x + w);
+	_clip.y2 = min(_clip.y2, y + h);
+	if (_clip.x2 < _clip.x1) _clip.x2 = _clip.x1;
+	if (_clip.y2 < _clip.y1) _clip.y2 = _clip.y1;
+}
+
+void ILI9341_due::popClipRect()
+{
+	if (_clipStackOverflow > 0)
+		_clipStackOverflow--;	// its previous rectangle was not saved, the clip stays as it is
+	else if (_clipStackSize > 0)
+		_clip = _clipStack[--_clipStackSize];
+}
+
+void ILI9341_due::resetClipRect()
+{
+	_clipStackSize = 0;
+	_clipStackOverflow = 0;
+	_clip.x1 = 0;
+	_clip.y1 = 0;
+	_clip.x2 = _width;
+	_clip.y2 = _height;
+}
 
 void ILI9341_due::setRotation(iliRotation r)
 {
+	flushDeferred();
 	beginTransaction();
 	writecommand_cont(ILI9341_MADCTL);
 	_rotation = r;
@@ -619,7 +1676,12 @@ void ILI9341_due::setRotation(iliRotation r)
 	//_area.y = 0;
 	_area.w = _width;
 	_area.h = _height;
+	resetClipRect();
 	endTransaction();
+
+	// hardware scrolling works only along the rows of GRAM, it has to be set up again
+	if (_textScroll || _scrollHeight > 0)
+		setTextScroll(_textScroll);
 }
 
 
@@ -634,20 +1696,83 @@ void ILI9341_due::invertDisplay(boolean i)
 // Reads one pixel/color from the TFT's GRAM
 uint16_t ILI9341_due::readPixel(int16_t x, int16_t y)
 {
+	ILI_STATS_SCOPE(iliStatsRead);
+	flushDeferred();
 	beginTransaction();
 	//setAddr_cont(x, y, x + 1, y + 1); ? should it not be x,y,x,y?
 	setAddr_cont(x, y, 1, 1);
 	writecommand_cont(ILI9341_RAMRD); // read from RAM
+	beginRead_cont();
 	readdata8_cont(); // dummy read
 	uint8_t red = read8_cont();
 	uint8_t green = read8_cont();
 	uint8_t blue = read8_last();
+	endRead_cont();
 	uint16_t color = color565(red, green, blue);
 	endTransaction();
 	return color;
 
 }
 
+// starts reading the GRAM of a rectangle, returns false if the rectangle is not fully on the screen
+bool ILI9341_due::readRect_start(int16_t x, int16_t y, uint16_t w, uint16_t h)
+{
+	if (x < 0 || y < 0 || x + w > _width || y + h > _height || w == 0 || h == 0)
+	{
+		Serial.println(F("Read rectangle is outside of the screen"));
+		return false;
+	}
+
+	flushDeferred();
+	beginTransaction();
+	setAddr_cont(x, y, w, h);
+	writecommand_cont(ILI9341_RAMRD); // read from RAM
+	beginRead_cont();
+	readdata8_cont(); // dummy read, also sets DC high
+	return true;
+}
+
+// Reads a rectangle of the TFT's GRAM into colors (w*h RGB565 values) with a single RAMRD
+void ILI9341_due::readRect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *colors)
+{
+	ILI_STATS_SCOPE(iliStatsRead);
+	if (!readRect_start(x, y, w, h))
+		return;
+
+	// the display sends 3 bytes per pixel, they are received into the scanline in chunks and packed to RGB565
+	uint8_t *rgb = (uint8_t*)_scanline16;
+	const uint16_t chunkPixels = sizeof(_scanline16) / 3;
+	uint32_t remainingPixels = (uint32_t)w * (uint32_t)h;
+	while (remainingPixels > 0)
+	{
+		const uint16_t n = min(remainingPixels, chunkPixels);
+		read_cont(rgb, 3 * n);
+		for (uint16_t i = 0; i < 3 * n; i += 3)
+		{
+			*colors++ = color565(rgb[i], rgb[i + 1], rgb[i + 2]);
+		}
+		remainingPixels -= n;
+	}
+	endRead_cont();
+	disableCS();
+	endTransaction();
+
+	fillScanline16(_color);	// the scanline was used as the receive buffer
+}
+
+// Reads a rectangle of the TFT's GRAM into rgb (w*h*3 bytes, red, green and blue of each pixel)
+void ILI9341_due::readRect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint8_t *rgb)
+{
+	ILI_STATS_SCOPE(iliStatsRead);
+	if (!readRect_start(x, y, w, h))
+		return;
+
+	read_cont(rgb, (uint32_t)w * (uint32_t)h * 3);
+	endRead_cont();
+	disableCS();
+	endTransaction();
+}
+
 //void ILI9341_due::drawArc(uint16_t cx, uint16_t cy, uint16_t radius, uint16_t thickness, uint16_t start, uint16_t end, uint16_t color) {
 //	//void graphics_draw_arc(GContext *ctx, GPoint p, int radius, int thickness, int start, int end) {
 //	start = start % 360;
@@ -702,6 +1827,7 @@ uint16_t ILI9341_due::readPixel(int16_t x, int16_t y)
 
 // DrawArc function thanks to Jnmattern and his Arc_2.0 (https://github.com/Jnmattern)
 void ILI9341_due::fillArcOffsetted(uint16_t cx, uint16_t cy, uint16_t radius, uint16_t thickness, float start, float end, uint16_t color) {
+	ILI_STATS_SCOPE(iliStatsArc);
 	int16_t xmin = 65535, xmax = -32767, ymin = 32767, ymax = -32767;
 	float cosStart, sinStart, cosEnd, sinEnd;
 	float r, t;
@@ -905,6 +2031,8 @@ void ILI9341_due::fillArcOffsetted(uint16_t cx, uint16_t cy, uint16_t radius, ui
 
 void ILI9341_due::screenshotToConsole()
 {
+	ILI_STATS_SCOPE(iliStatsRead);
+	flushDeferred();
 	uint8_t lastColor[3];
 	uint8_t color[3];
 	uint32_t sameColorPixelCount = 0;
@@ -918,6 +2046,7 @@ void ILI9341_due::screenshotToConsole()
 	beginTransaction();
 	setAddr_cont(0, 0, _width, _height);
 	writecommand_cont(ILI9341_RAMRD); // read from RAM
+	beginRead_cont();
 	readdata8_cont(); // dummy read, also sets DC high
 
 #if SPI_MODE_DMA
@@ -969,6 +2098,7 @@ void ILI9341_due::screenshotToConsole()
 			lastColor[2] = color[2];
 	}
 }
+	endRead_cont();
 	disableCS();
 	endTransaction();
 	sameColorPixelCount = (uint32_t)_width*(uint32_t)_height - sameColorStartIndex;
@@ -992,6 +2122,140 @@ void ILI9341_due::screenshotToConsole()
 	Serial.println(totalImageDataLength);
 }
 
+// CRC-32 (polynomial 0xEDB88320) calculated 4 bits at a time
+static const uint32_t crc32_nibbles[16] PROGMEM = {
+	0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+	0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t *data, uint16_t length)
+{
+	while (length--)
+	{
+		crc ^= *data++;
+		crc = pgm_read_dword(&crc32_nibbles[crc & 0x0F]) ^ (crc >> 4);
+		crc = pgm_read_dword(&crc32_nibbles[crc & 0x0F]) ^ (crc >> 4);
+	}
+	return crc;
+}
+
+// collects the bytes of a screenshot frame and sends them in blocks, keeps the CRC of what was sent
+class ScreenshotWriter
+{
+public:
+	ScreenshotWriter(Print &out, iliScreenshotFormat format) : _out(out), _format(format), _crc(0xFFFFFFFF), _length(0) {}
+
+	void write(uint8_t b) {
+		_buffer[_length++] = b;
+		if (_length == sizeof(_buffer))
+			flush();
+	}
+	void write16(uint16_t w) {
+		write(w);
+		write(w >> 8);
+	}
+	void flush() {
+		_crc = crc32Update(_crc, _buffer, _length);
+		_out.write(_buffer, _length);
+		_length = 0;
+	}
+	void writeRun(uint16_t length, uint32_t color) {
+		write(length - 1);
+		if (_format == iliScreenshot565)
+			write16(color);
+		else
+		{
+			write(color >> 16);
+			write(color >> 8);
+			write(color);
+		}
+	}
+	void writeCRC() {
+		flush();
+		const uint32_t crc = ~_crc;
+		for (uint8_t i = 0; i < 4; i++)
+			_buffer[i] = crc >> (8 * i);
+		_out.write(_buffer, 4);
+	}
+
+private:
+	Print &_out;
+	iliScreenshotFormat _format;
+	uint32_t _crc;
+	uint8_t _buffer[32];
+	uint8_t _length;
+};
+
+// Sends the screen as a binary frame of color runs (see ILI_SCREENSHOT_VERSION in ILI9341_due.h).
+// The GRAM is read in chunks of the scanline's size, the bus is released after each chunk
+// and the runs are sent while it is free.
+// With rowCrcs, a row is read first only to calculate its CRC and, if it differs from the one in rowCrcs,
+// read once more to be sent. Reading a row takes a fraction of the time sending it does.
+void ILI9341_due::screenshot(Print &out, iliScreenshotFormat format, uint32_t *rowCrcs)
+{
+	ILI_STATS_SCOPE(iliStatsRead);
+	flushDeferred();
+
+	uint8_t *rgb = (uint8_t*)_scanline16;
+	const uint16_t chunkPixels = sizeof(_scanline16) / 3;
+	ScreenshotWriter writer(out, format);
+
+	out.write((const uint8_t*)"ILSS", 4);
+	writer.write(ILI_SCREENSHOT_VERSION);
+	writer.write(format);
+	writer.write16(_width);
+	writer.write16(_height);
+
+	for (int16_t y = 0; y < _height; y++)
+	{
+		if (rowCrcs)
+		{
+			uint32_t crc = 0xFFFFFFFF;
+			for (int16_t x = 0; x < _width; x += chunkPixels)
+			{
+				const uint16_t n = min(_width - x, chunkPixels);
+				readRect(x, y, n, 1, rgb);
+				crc = crc32Update(crc, rgb, 3 * n);
+			}
+			crc = ~crc;
+			if (crc == 0)
+				crc = 1;	// 0 stands for no previous frame
+			if (crc == rowCrcs[y])
+			{
+				writer.write(ILI_SCREENSHOT_ROW_SAME);
+				continue;
+			}
+			rowCrcs[y] = crc;
+		}
+
+		writer.write(ILI_SCREENSHOT_ROW_RUNS);
+		uint32_t runColor = 0;
+		uint16_t runLength = 0;
+		for (int16_t x = 0; x < _width; x += chunkPixels)
+		{
+			const uint16_t n = min(_width - x, chunkPixels);
+			readRect(x, y, n, 1, rgb);
+			for (uint16_t i = 0; i < 3 * n; i += 3)
+			{
+				const uint32_t color = format == iliScreenshot565 ?
+					color565(rgb[i], rgb[i + 1], rgb[i + 2]) :
+					((uint32_t)(rgb[i] & 0xFC) << 16) | ((uint16_t)(rgb[i + 1] & 0xFC) << 8) | (rgb[i + 2] & 0xFC);
+				if (runLength > 0 && (color != runColor || runLength == 256))
+				{
+					writer.writeRun(runLength, runColor);
+					runLength = 0;
+				}
+				runColor = color;
+				runLength++;
+			}
+		}
+		writer.writeRun(runLength, runColor);
+	}
+	writer.writeCRC();
+
+	fillScanline16(_color);	// the scanline was used as the receive buffer
+}
+
 /*
 This is the core graphics library for all our displays, providing a common
 set of graphics primitives (points, lines, circles, etc.).  It needs to bex
@@ -1028,12 +2292,14 @@ POSSIBILITY OF SUCH DAMAGE.
 // Draw a circle outline
 void ILI9341_due::drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsCircle);
 
 	int16_t f = 1 - r;
 	int16_t ddF_x = 1;
 	int16_t ddF_y = -2 * r;
 	int16_t x = 0;
 	int16_t y = r;
+	if (!isRectVisible(x0 - r, y0 - r, 2 * r + 1, 2 * r + 1)) return;
 	beginTransaction();
 	enableCS();
 
@@ -1107,6 +2373,8 @@ void ILI9341_due::drawCircleHelper(int16_t x0, int16_t y0,
 void ILI9341_due::fillCircle(int16_t x0, int16_t y0, int16_t r,
 	uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsFillCircle);
+	if (!isRectVisible(x0 - r, y0 - r, 2 * r + 1, 2 * r + 1)) return;
 	beginTransaction();
 	drawFastVLine_noTrans(x0, y0 - r, 2 * r + 1, color);
 	fillCircleHelper(x0, y0, r, 3, 0, color);
@@ -1155,6 +2423,7 @@ void ILI9341_due::fillCircleHelper(int16_t x0, int16_t y0, int16_t r,
 
 void ILI9341_due::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsLine);
 	beginTransaction();
 	drawLine_noTrans(x0, y0, x1, y1, color);
 	endTransaction();
@@ -1162,6 +2431,7 @@ void ILI9341_due::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint1
 
 void ILI9341_due::drawLineByAngle(int16_t x, int16_t y, int16_t angle, uint16_t length, uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsLine);
 	beginTransaction();
 	drawLine_noTrans(
 		x,
@@ -1174,6 +2444,7 @@ void ILI9341_due::drawLineByAngle(int16_t x, int16_t y, int16_t angle, uint16_t
 
 void ILI9341_due::drawLineByAngle(int16_t x, int16_t y, int16_t angle, uint16_t start, uint16_t length, uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsLine);
 	beginTransaction();
 	drawLine_noTrans(
 		x + start*cosDegrees(angle + _angleOffset),
@@ -1186,6 +2457,7 @@ void ILI9341_due::drawLineByAngle(int16_t x, int16_t y, int16_t angle, uint16_t
 // Bresenham's algorithm - thx wikpedia
 void ILI9341_due::drawLine_noTrans(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
 {
+	if (!isRectVisible(min(x0, x1), min(y0, y1), abs(x1 - x0) + 1, abs(y1 - y0) + 1)) return;
 	beginTransaction();
 	if (y0 == y1) {
 		if (x1 > x0) {
@@ -1251,7 +2523,7 @@ void ILI9341_due::drawLine_noTrans(int16_t x0, int16_t y0, int16_t x1, int16_t y
 #endif
 				}
 				else {
-					writePixel_cont(y0, x0, color);
+					drawPixel_cont(y0, x0, color);
 				}
 				xbegin = x0 + 1;
 				y0 += ystep;
@@ -1280,7 +2552,7 @@ void ILI9341_due::drawLine_noTrans(int16_t x0, int16_t y0, int16_t x1, int16_t y
 #endif
 				}
 				else {
-					writePixel_cont(x0, y0, color);
+					drawPixel_cont(x0, y0, color);
 				}
 				xbegin = x0 + 1;
 				y0 += ystep;
@@ -1311,6 +2583,8 @@ void ILI9341_due::drawLine_noTrans(int16_t x0, int16_t y0, int16_t x1, int16_t y
 
 void ILI9341_due::drawRect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsRect);
+	if (!isRectVisible(x, y, w, h)) return;
 	beginTransaction();
 
 	fillScanline16(color, min(SCANLINE_PIXEL_COUNT, max(w, h)));
@@ -1327,6 +2601,8 @@ void ILI9341_due::drawRect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_
 // Draw a rounded rectangle
 void ILI9341_due::drawRoundRect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t r, uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsRoundRect);
+	if (!isRectVisible(x, y, w, h)) return;
 	beginTransaction();
 
 	fillScanline16(color, min(SCANLINE_PIXEL_COUNT, max(w, h)));
@@ -1349,6 +2625,8 @@ void ILI9341_due::drawRoundRect(int16_t x, int16_t y, uint16_t w, uint16_t h, ui
 // Fill a rounded rectangle
 void ILI9341_due::fillRoundRect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t r, uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsFillRoundRect);
+	if (!isRectVisible(x, y, w, h)) return;
 	beginTransaction();
 	// smarter version
 	fillRect_noTrans(x + r, y, w - 2 * r, h, color);
@@ -1364,6 +2642,9 @@ void ILI9341_due::drawTriangle(int16_t x0, int16_t y0,
 	int16_t x1, int16_t y1,
 	int16_t x2, int16_t y2, uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsTriangle);
+	const int16_t xMin = min(x0, min(x1, x2)), yMin = min(y0, min(y1, y2));
+	if (!isRectVisible(xMin, yMin, max(x0, max(x1, x2)) - xMin + 1, max(y0, max(y1, y2)) - yMin + 1)) return;
 	beginTransaction();
 	drawLine_noTrans(x0, y0, x1, y1, color);
 	drawLine_noTrans(x1, y1, x2, y2, color);
@@ -1376,6 +2657,9 @@ void ILI9341_due::fillTriangle(int16_t x0, int16_t y0,
 	int16_t x1, int16_t y1,
 	int16_t x2, int16_t y2, uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsFillTriangle);
+	const int16_t xMin = min(x0, min(x1, x2)), yMin = min(y0, min(y1, y2));
+	if (!isRectVisible(xMin, yMin, max(x0, max(x1, x2)) - xMin + 1, max(y0, max(y1, y2)) - yMin + 1)) return;
 	beginTransaction();
 	int16_t a, b, y, last;
 
@@ -1459,16 +2743,22 @@ void ILI9341_due::fillTriangle(int16_t x0, int16_t y0,
 // draws monochrome (single color) bitmaps
 void ILI9341_due::drawBitmap(const uint8_t *bitmap, int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsImage);
 	uint16_t i, j, byteWidth = (w + 7) / 8;
 
+	// only the visible part of the bitmap is walked through
+	int16_t cx = x, cy = y, cw = w, ch = h;
+	if (!clipRect(cx, cy, cw, ch)) return;
+	const uint16_t i0 = cx - x, i1 = i0 + cw, j0 = cy - y, j1 = j0 + ch;
+
 	beginTransaction();
 	enableCS();
-	for (j = 0; j < h; j++)
+	for (j = j0; j < j1; j++)
 	{
-		for (i = 0; i < w; i++)
+		for (i = i0; i < i1; i++)
 		{
 			if (pgm_read_byte(bitmap + j * byteWidth + i / 8) & (128 >> (i & 7))) {
-				drawPixel_cont(x + i, y + j, color);
+				writePixel_cont(x + i, y + j, color);
 			}
 		}
 	}
@@ -1479,34 +2769,42 @@ void ILI9341_due::drawBitmap(const uint8_t *bitmap, int16_t x, int16_t y, uint16
 // draws monochrome (single color) bitmaps
 void ILI9341_due::drawBitmap(const uint8_t *bitmap, int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t color, uint16_t bgcolor)
 {
+	ILI_STATS_SCOPE(iliStatsImage);
 	uint16_t i, j, byteWidth = (w + 7) / 8;
 
+	int16_t cx = x, cy = y, cw = w, ch = h;
+	if (!clipRect(cx, cy, cw, ch)) return;
+	const uint16_t i0 = cx - x, i1 = i0 + cw, j0 = cy - y, j1 = j0 + ch;
+
+#ifdef ARDUINO_SAM_DUE
+	flushDeferred();	// rows are written straight from the scanline
+#endif
 	beginTransaction();
 	enableCS();
-	for (j = 0; j < h; j++)
+	for (j = j0; j < j1; j++)
 	{
-		for (i = 0; i < w; i++)
+		for (i = i0; i < i1; i++)
 		{
 			if (pgm_read_byte(bitmap + j * byteWidth + i / 8) & (128 >> (i & 7))) {
 #if defined ARDUINO_ARCH_AVR
-				drawPixel_cont(x + i, y + j, color);
+				writePixel_cont(x + i, y + j, color);
 #elif defined ARDUINO_SAM_DUE
-				_scanline16[i] = color;
+				_scanline16[i - i0] = color;
 #endif
 			}
 			else
 			{
 #if defined ARDUINO_ARCH_AVR
-				drawPixel_cont(x + i, y + j, bgcolor);
+				writePixel_cont(x + i, y + j, bgcolor);
 #elif defined ARDUINO_SAM_DUE
-				_scanline16[i] = bgcolor;
+				_scanline16[i - i0] = bgcolor;
 #endif
 		}
 		}
 #ifdef ARDUINO_SAM_DUE
-		setAddrAndRW_cont(x, y + j, w, 1);
+		setAddrAndRW_cont(cx, y + j, cw, 1);
 		setDCForData();
-		writeScanline16(w);
+		writeScanline16(cw);
 #endif
 	}
 	disableCS();
@@ -1719,21 +3017,30 @@ void ILI9341_due::printHex32(uint32_t *data, uint8_t length) // prints 8-bit dat
 
 void ILI9341_due::clearTextArea()
 {
-	fillRect(_area.x, _area.y, _area.w, _area.h, _fontBgColor);
+	ILI_STATS_SCOPE(iliStatsText);
+	clearTextArea(_fontBgColor);
 }
 
 void ILI9341_due::clearTextArea(uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsText);
 	fillRect(_area.x, _area.y, _area.w, _area.h, color);
+	if (_scrollOffset > 0)
+	{
+		_scrollOffset = 0;
+		writeScrollArea();
+	}
 }
 
 void ILI9341_due::clearTextArea(gTextArea area)
 {
+	ILI_STATS_SCOPE(iliStatsText);
 	fillRect(area.x, area.y, area.w, area.h, _fontBgColor);
 }
 
 void ILI9341_due::clearTextArea(gTextArea area, uint16_t color)
 {
+	ILI_STATS_SCOPE(iliStatsText);
 	fillRect(area.x, area.y, area.w, area.h, color);
 }
 
@@ -1745,6 +3052,8 @@ void ILI9341_due::setTextArea(gTextArea area) //, textMode mode)
 	_area.h = area.h;
 	_x = _xStart = area.x;
 	_y = _yStart = area.y;
+	if (_textScroll)
+		setTextScroll(true);
 }
 
 //void ILI9341_due::setTextArea(int16_t x0, int16_t y0, int16_t x1, int16_t y1) //, textMode mode)
@@ -1764,7 +3073,7 @@ void ILI9341_due::setTextArea(int16_t x, int16_t y, int16_t columns, int16_t row
 
 	setFont(font);
 
-	x1 = x + columns * (pgm_read_byte(_font + GTEXT_FONT_FIXED_WIDTH) + 1) - 1;
+	x1 = x + columns * (getFontColumnWidth(_font) + 1) - 1;
 	y1 = y + rows * (getFontHeight() + 1) - 1;
 
 	setTextArea(x, y, x1, y1); //, mode);
@@ -1777,7 +3086,122 @@ void ILI9341_due::setTextArea(int16_t x, int16_t y, int16_t w, int16_t h) //, te
 	_area.w = w;
 	_area.h = h;
 	_x = _xStart = x;
-	_y = _xStart = y;
+	_y = _yStart = y;
+	if (_textScroll)
+		setTextScroll(true);
+}
+
+// When enabled, a new line that does not fit into the text area scrolls the area up by one line
+// and only the new line gets cleared (with the background color of the font).
+// If the text area spans whole rows of the screen in portrait (0 or 180) rotation, the display's
+// vertical scrolling is used and no pixels are moved. The lines of such area are then shown at
+// different rows than they are stored at, so only print into it while it is scrolled.
+// Otherwise the area is scrolled by reading the pixels back and writing them one line higher.
+// Set the font, text scale and line spacing before calling this.
+void ILI9341_due::setTextScroll(bool scroll)
+{
+	_textScroll = scroll;
+	_scrollOffset = 0;
+	_scrollHeight = 0;
+	if (scroll && _font != 0 && (_rotation == iliRotation0 || _rotation == iliRotation180) && _area.x == 0 && _area.w >= _width)
+	{
+		// the scrolling area holds whole lines, so that a line never wraps around its bottom
+		const uint16_t lineHeight = (getFontHeight() + _lineSpacing) * _textScale;
+		_scrollHeight = (min(_area.h, _height - _area.y) / lineHeight) * lineHeight;
+	}
+	writeScrollArea();
+}
+
+// sends the vertical scrolling definition and start address
+void ILI9341_due::writeScrollArea()
+{
+	// rows are counted in GRAM, in 180 rotation they go from the bottom of the screen
+	uint16_t top = 0, height = ILI9341_TFTHEIGHT, start = 0;
+	if (_scrollHeight > 0)
+	{
+		height = _scrollHeight;
+		if (_rotation == iliRotation0)
+		{
+			top = _area.y;
+			start = top + _scrollOffset;
+		}
+		else
+		{
+			top = ILI9341_TFTHEIGHT - _area.y - _scrollHeight;
+			start = top + (_scrollHeight - _scrollOffset) % _scrollHeight;
+		}
+	}
+
+	flushDeferred();
+	beginTransaction();
+	writecommand_cont(ILI9341_VSCRDEF);
+	setDCForData();
+	write16_cont(top);
+	write16_cont(height);
+	write16_cont(ILI9341_TFTHEIGHT - top - height);
+	writecommand_cont(ILI9341_VSCRSADD);
+	setDCForData();
+	write16_last(start);
+	endTransaction();
+}
+
+// makes room for a new line of text at the bottom of the text area
+void ILI9341_due::scrollTextArea(uint16_t lineHeight)
+{
+	if (_scrollHeight > 0)
+	{
+		// the display shows the area shifted by one more line, the line that wraps around
+		// from the top becomes the new bottom line
+		_scrollOffset = (_scrollOffset + lineHeight) % _scrollHeight;
+		writeScrollArea();
+		_y = _area.y + _scrollHeight - lineHeight;
+		fillRect(_area.x, scrolledY(_y), _area.w, lineHeight, _fontBgColor);
+		return;
+	}
+
+	const int16_t bottom = _area.y + _area.h;
+	const int16_t pixels = _y + 2 * lineHeight - bottom;
+	if (pixels >= (int16_t)_area.h)
+	{
+		// nothing that is in the area would stay visible
+		fillRect(_area.x, _area.y, _area.w, _area.h, _fontBgColor);
+	}
+	else
+	{
+		scrollTextAreaSoftware(pixels);
+	}
+	_y = max(bottom - (int16_t)lineHeight, (int16_t)_area.y);
+	fillRect(_area.x, _y, _area.w, bottom - _y, _fontBgColor);
+}
+
+// moves the text area up by reading its rows back and writing them higher, as many whole rows
+// as fit in the buffer are read with one readRect and written through one address window
+void ILI9341_due::scrollTextAreaSoftware(uint16_t pixels)
+{
+	if (_area.w == 0)
+		return;
+
+	uint16_t buf[SCANLINE_PIXEL_COUNT];
+	const int16_t bottom = _area.y + _area.h;
+	const uint16_t maxRows = _area.w < SCANLINE_PIXEL_COUNT ? SCANLINE_PIXEL_COUNT / _area.w : 1;
+	uint16_t rows;
+
+	for (int16_t y = _area.y; y + pixels < bottom; y += rows)
+	{
+		rows = min(maxRows, (uint16_t)(bottom - pixels - y));
+		for (uint16_t x = 0; x < _area.w; x += SCANLINE_PIXEL_COUNT)
+		{
+			const uint16_t n = min(_area.w - x, SCANLINE_PIXEL_COUNT);
+			readRect(_area.x + x, y + pixels, n, rows, buf);
+			beginTransaction();
+			enableCS();
+			setAddrAndRW_cont(_area.x + x, y, n, rows);
+			setDCForData();
+			write_cont(buf, (uint32_t)n * rows);
+			disableCS();
+			endTransaction();
+		}
+	}
 }
 
 __attribute__((always_inline))
@@ -1877,9 +3301,13 @@ void ILI9341_due::specialChar(uint8_t c)
 			* Room for simple wrap
 			*/
 
+		const uint16_t lineHeight = (height + _lineSpacing)*_textScale;
 		_x = _xStart; // _area.x;
-		_y = _y + (height + _lineSpacing)*_textScale;
 		_isFirstChar = true;
+		if (_textScroll && _y + 2 * lineHeight > _area.y + (_scrollHeight > 0 ? _scrollHeight : _area.h))
+			scrollTextArea(lineHeight);
+		else
+			_y = _y + lineHeight;
 
 		//			}
 		//		}
@@ -1939,6 +3367,7 @@ void ILI9341_due::specialChar(uint8_t c)
 
 size_t ILI9341_due::write(uint8_t c)
 {
+	ILI_STATS_SCOPE(iliStatsText);
 	//Serial << c << endl2;
 	if (_font == 0)
 	{
@@ -1957,54 +3386,65 @@ size_t ILI9341_due::write(uint8_t c)
 	}
 	uint16_t charWidth = 0;
 	uint16_t charHeight = getFontHeight();
-	uint8_t charHeightInBytes = (charHeight + 7) / 8; /* calculates height in rounded up bytes */
-
-	uint8_t firstChar = pgm_read_byte(_font + GTEXT_FONT_FIRST_CHAR);
-	uint8_t charCount = pgm_read_byte(_font + GTEXT_FONT_CHAR_COUNT);
-
 	uint16_t index = 0;
+	const uint8_t *glyph = NULL;
 
-	if (c < firstChar || c >= (firstChar + charCount)) {
-		return 0; // invalid char
+	if (isExtendedFont(_font))
+	{
+		glyph = getExtendedGlyph(c, _font);
+		if (glyph == NULL)
+			return 0; // invalid char
+		charWidth = pgm_read_byte(glyph);
 	}
-	c -= firstChar;
+	else
+	{
+		uint8_t charHeightInBytes = (charHeight + 7) / 8; /* calculates height in rounded up bytes */
 
-	if (isFixedWidthFont(_font) {
-		//thielefont = 0;
-		charWidth = pgm_read_byte(_font + GTEXT_FONT_FIXED_WIDTH);
-		index = c*charHeightInBytes*charWidth + GTEXT_FONT_WIDTH_TABLE;
-	}
-	else {
-		// variable width font, read width data, to get the index
-		//thielefont = 1;
-		/*
-		* Because there is no table for the offset of where the data
-		* for each character glyph starts, run the table and add up all the
-		* widths of all the characters prior to the character we
-		* need to locate.
-		*/
-		for (uint8_t i = 0; i < c; i++) {
-			index += pgm_read_byte(_font + GTEXT_FONT_WIDTH_TABLE + i);
+		uint8_t firstChar = pgm_read_byte(_font + GTEXT_FONT_FIRST_CHAR);
+		uint8_t charCount = pgm_read_byte(_font + GTEXT_FONT_CHAR_COUNT);
+
+		if (c < firstChar || c >= (firstChar + charCount)) {
+			return 0; // invalid char
 		}
-		/*
-		* Calculate the offset of where the font data
-		* for our character starts.
-		* The index value from above has to be adjusted because
-		* there is potentialy more than 1 byte per column in the glyph,
-		* when the characgter is taller than 8 bits.
-		* To account for this, index has to be multiplied
-		* by the height in bytes because there is one byte of font
-		* data for each vertical 8 pixels.
-		* The index is then adjusted to skip over the font width data
-		* and the font header information.
-		*/
+		c -= firstChar;
+
+		if (isFixedWidthFont(_font) {
+			//thielefont = 0;
+			charWidth = pgm_read_byte(_font + GTEXT_FONT_FIXED_WIDTH);
+			index = c*charHeightInBytes*charWidth + GTEXT_FONT_WIDTH_TABLE;
+		}
+		else {
+			// variable width font, read width data, to get the index
+			//thielefont = 1;
+			/*
+			* Because there is no table for the offset of where the data
+			* for each character glyph starts, run the table and add up all the
+			* widths of all the characters prior to the character we
+			* need to locate.
+			*/
+			for (uint8_t i = 0; i < c; i++) {
+				index += pgm_read_byte(_font + GTEXT_FONT_WIDTH_TABLE + i);
+			}
+			/*
+			* Calculate the offset of where the font data
+			* for our character starts.
+			* The index value from above has to be adjusted because
+			* there is potentialy more than 1 byte per column in the glyph,
+			* when the characgter is taller than 8 bits.
+			* To account for this, index has to be multiplied
+			* by the height in bytes because there is one byte of font
+			* data for each vertical 8 pixels.
+			* The index is then adjusted to skip over the font width data
+			* and the font header information.
+			*/
 
-		index = index*charHeightInBytes + charCount + GTEXT_FONT_WIDTH_TABLE;
+			index = index*charHeightInBytes + charCount + GTEXT_FONT_WIDTH_TABLE;
 
-		/*
-		* Finally, fetch the width of our character
-		*/
-		charWidth = pgm_read_byte(_font + GTEXT_FONT_WIDTH_TABLE + c);
+			/*
+			* Finally, fetch the width of our character
+			*/
+			charWidth = pgm_read_byte(_font + GTEXT_FONT_WIDTH_TABLE + c);
+		}
 	}
 
 	//#ifndef GLCD_NODEFER_SCROLL
@@ -2043,12 +3483,46 @@ size_t ILI9341_due::write(uint8_t c)
 	//		}
 	//#endif
 	//	}
+
+	// skip the whole glyph (including the letter spacing in front of it) if it is outside of the clip rectangle
+	const int16_t spacingWidth = (_letterSpacing > 0 && !_isFirstChar) ? _letterSpacing * _textScale : 0;
+	if (!isRectVisible(_x, _y, spacingWidth + charWidth * _textScale, charHeight * _textScale))
+	{
+		_x += spacingWidth + charWidth * _textScale;
+		_isFirstChar = false;
+		return 1;
+	}
+
+#ifdef ILI_USE_DEFERRED_SPANS
+	// glyphs are written column by column straight to GRAM, whatever is queued has to go first
+	const bool wasDeferred = _isDeferred;
+	flushDeferred();
+	_isDeferred = false;
+#endif
+	// with hardware scrolling the line is stored at a different row than it is shown at
+	const int16_t shownY = _y;
+	_y = scrolledY(_y);
 	beginTransaction();
-	if (_fontMode == gTextFontModeSolid)
+	const uint8_t *data = glyph ? getExtendedGlyphData(glyph, _font) : NULL;
+	const uint8_t encoding = glyph ? pgm_read_byte(_font + GTEXT_XFONT_ENCODING) : (uint8_t)gTextGlyphBitmap;
+#ifdef ILI_USE_GLYPH_CACHE
+	// RLE glyphs are runs already
+	iliGlyphCacheSlot *cached = encoding == gTextGlyphBitmap ? getCachedGlyph(c, data, index, charWidth, charHeight) : NULL;
+	if (cached)
+		drawExtendedChar(cached->runs, gTextGlyphRLE, true, charWidth, charHeight);
+	else
+#endif
+	if (glyph)
+		drawExtendedChar(data, encoding, false, charWidth, charHeight);
+	else if (_fontMode == gTextFontModeSolid)
 		drawSolidChar(c, index, charWidth, charHeight);
 	else if (_fontMode == gTextFontModeTransparent)
 		drawTransparentChar(c, index, charWidth, charHeight);
 	endTransaction();
+	_y = shownY;
+#ifdef ILI_USE_DEFERRED_SPANS
+	_isDeferred = wasDeferred;
+#endif
 
 	return 1; // valid char
 }
@@ -2057,6 +3531,7 @@ void ILI9341_due::drawSolidChar(char c, uint16_t index, uint16_t charWidth, uint
 {
 	uint8_t bitId = 0;
 	uint16_t py;
+	int16_t pointY = 0, pointHeight = 0;
 #ifdef ARDUINO_SAM_DUE
 	uint16_t lineId = 0;
 #endif
@@ -2093,9 +3568,14 @@ void ILI9341_due::drawSolidChar(char c, uint16_t index, uint16_t charWidth, uint
 	//		fillScanline16(_fontColor, numPixelsInOnePoint);	//pre-fill the scanline, we will be drawing different lenghts of it
 	//#endif
 
+	// rows of the glyph that are inside the clip rectangle
+	const int16_t visibleY1 = max(_y, _clip.y1);
+	const int16_t visibleY2 = min(_y + (int16_t)(charHeight * _textScale), _clip.y2);
+	int16_t cx, cw;
+
 	enableCS();
 	if (_textScale == 1)
-		setRowAddr(_y, charHeight);
+		setRowAddr(visibleY1, visibleY2 - visibleY1);
 
 	for (uint16_t j = 0; j < charWidth; j++) /* each column */
 	{
@@ -2104,9 +3584,11 @@ void ILI9341_due::drawSolidChar(char c, uint16_t index, uint16_t charWidth, uint
 		lineId = 0;
 #endif
 		numRenderBits = 8;
-		if (_x >= 0 && _x < _width)
+		cx = max(_x, _clip.x1);
+		cw = min(_x + _textScale, _clip.x2) - cx;
+		if (cw > 0)
 		{
-			setColumnAddr(_x, _textScale);
+			setColumnAddr(cx, cw);
 
 			if (_textScale == 1)
 			{
@@ -2143,6 +3625,18 @@ void ILI9341_due::drawSolidChar(char c, uint16_t index, uint16_t charWidth, uint
 				for (bitId = 0; bitId < numRenderBits; bitId++)
 				{
 					py = _y + (i * 8 + bitId)*_textScale;
+					// point is above or below the clip rectangle
+					if ((int16_t)py + _textScale <= visibleY1 || (int16_t)py >= visibleY2)
+					{
+						data >>= 1;
+						continue;
+					}
+					if (_textScale > 1)
+					{
+						pointY = max((int16_t)py, visibleY1);
+						pointHeight = min((int16_t)py + _textScale, visibleY2) - pointY;
+						numPixelsInOnePoint = cw * pointHeight;
+					}
 					if ((data & 0x01) == 0)
 					{
 						if (_textScale == 1)
@@ -2157,7 +3651,7 @@ void ILI9341_due::drawSolidChar(char c, uint16_t index, uint16_t charWidth, uint
 						{
 							// set a rectangle area
 							//setAddrAndRW_cont(_x, py, _textScale, _textScale);
-							setRowAddr(py, _textScale);
+							setRowAddr(pointY, pointHeight);
 							setRW();
 							//Serial << cx << " " << cy + (i * 8 + bitId)*_textScale << " " << _textScale <<endl2;
 							setDCForData();
@@ -2186,7 +3680,7 @@ void ILI9341_due::drawSolidChar(char c, uint16_t index, uint16_t charWidth, uint
 						{
 							// set a rectangle area
 							//setAddrAndRW_cont(_x, py, _textScale, _textScale);
-							setRowAddr(py, _textScale);
+							setRowAddr(pointY, pointHeight);
 							setRW();
 							setDCForData();
 #ifdef ARDUINO_ARCH_AVR
@@ -2216,9 +3710,9 @@ void ILI9341_due::drawSolidChar(char c, uint16_t index, uint16_t charWidth, uint
 				}
 		//Serial << endl;
 #ifdef ARDUINO_SAM_DUE
-		if (_textScale == 1)
+		if (_textScale == 1 && cw > 0)
 		{
-			writeScanline16(charHeight);
+			writeScanline16(lineId);
 		}
 #endif
 		_x += _textScale;
@@ -2240,6 +3734,7 @@ void ILI9341_due::drawTransparentChar(char c, uint16_t index, uint16_t charWidth
 	uint8_t bit = 0, lastBit = 0;
 	uint16_t lineStart = 0;
 	uint16_t lineEnd = 0;
+	int16_t cx, cw;
 	if (_letterSpacing > 0 && !_isFirstChar)
 	{
 		_x += _letterSpacing * _textScale;
@@ -2261,10 +3756,12 @@ void ILI9341_due::drawTransparentChar(char c, uint16_t index, uint16_t charWidth
 	{
 		//Serial << "Printing row" << endl;
 		numRenderBits = 8;
+		cx = max(_x, _clip.x1);
+		cw = min(_x + _textScale, _clip.x2) - cx;
 
-		if (_x >= 0 && _x < _width)
+		if (cw > 0)
 		{
-			setColumnAddr(_x, _textScale);
+			setColumnAddr(cx, cw);
 
 			for (uint16_t i = 0; i < charHeightInBytes; i++)	/* each vertical byte */
 			{
@@ -2288,7 +3785,7 @@ void ILI9341_due::drawTransparentChar(char c, uint16_t index, uint16_t charWidth
 				//Serial << "data:" <<data << " x:" << cx << " y:" << cy << endl;
 
 				if (i == 0)
-					bit = lastBit = lineStart = 0;
+					bit = lastBit = lineStart = lineEnd = 0;
 				else if (i == charHeightInBytes - 1)	// last byte in column
 					numRenderBits = numRemainingBits;
 
@@ -2303,12 +3800,8 @@ void ILI9341_due::drawTransparentChar(char c, uint16_t index, uint16_t charWidth
 						}
 						else
 						{
-							const uint32_t totalPixels = (lineEnd - lineStart + _textScale) * _textScale;
 							//setRowAddr(_y + lineStart, _y + lineEnd + _textScale - 1);
-							setRowAddr(_y + lineStart, lineEnd - lineStart + _textScale);
-							setRW();
-							setDCForData();
-							writeScanlineLooped(totalPixels);
+							writeCharSpan_cont(_y + lineStart, lineEnd - lineStart + _textScale, cw);
 
 							//setAddrAndRW_cont(_x, _y + lineStart, _textScale, lineEnd - lineStart + _textScale);
 							////fillRect(cx, cy + lineStart, _textScale, lineEnd - lineStart + _textScale, ILI9341_BLUEVIOLET);
@@ -2332,12 +3825,8 @@ void ILI9341_due::drawTransparentChar(char c, uint16_t index, uint16_t charWidth
 
 				if (lineEnd == (charHeight - 1) * _textScale)	// we have a line that goes all the way to the bottom
 				{
-					const uint32_t totalPixels = uint32_t(lineEnd - lineStart + _textScale)*(uint32_t)_textScale;
 					//setRowAddr(_y + lineStart, _y + lineEnd + _textScale - 1);
-					setRowAddr(_y + lineStart, lineEnd - lineStart + _textScale);
-					setRW();
-					setDCForData();
-					writeScanlineLooped(totalPixels);
+					writeCharSpan_cont(_y + lineStart, lineEnd - lineStart + _textScale, cw);
 
 					////fillRect(cx, cy + lineStart, _textScale, lineEnd - lineStart + _textScale, ILI9341_BLUEVIOLET);
 					//setAddrAndRW_cont(_x, _y + lineStart, _textScale, lineEnd - lineStart + _textScale);
@@ -2359,6 +3848,399 @@ void ILI9341_due::drawTransparentChar(char c, uint16_t index, uint16_t charWidth
 	//_x = cx;
 }
 
+// writes one vertical run of a transparent glyph column, rows outside of the clip rectangle are left out
+void ILI9341_due::writeCharSpan_cont(int16_t y, int16_t h, int16_t w)
+{
+	if (y < _clip.y1) { h -= _clip.y1 - y; y = _clip.y1; }
+	if (y + h > _clip.y2) h = _clip.y2 - y;
+	if (h <= 0)
+		return;
+
+	setRowAddr(y, h);
+	setRW();
+	setDCForData();
+	writeScanlineLooped((uint32_t)h * (uint32_t)w);
+}
+
+// reads the rows of an extended font glyph as runs of set and unset pixels
+class GlyphRunReader
+{
+public:
+	GlyphRunReader(const uint8_t *data, uint16_t width, uint8_t encoding, bool isInRAM)
+		: _data(data), _width(width), _x(0), _rle(encoding == gTextGlyphRLE), _set(false), _isInRAM(isInRAM), _run(data + 1) {}
+
+	// number of identical rows starting with this one
+	uint8_t rowCount() {
+		return _rle ? readByte(_data) : 1;
+	}
+
+	// next run of the row, false at the end of the row
+	bool nextRun(bool &set, uint16_t &length) {
+		if (_x >= _width)
+			return false;
+		if (_rle)
+		{
+			do {
+				length = readByte(_run++);
+				set = _set;
+				_set = !_set;
+			} while (length == 0);
+			_x += length;
+			return true;
+		}
+		const uint16_t start = _x;
+		uint8_t bits = pgm_read_byte(_data + (_x >> 3)) << (_x & 7);
+		set = bits & 0x80;
+		const uint8_t sameByte = set ? 0xFF : 0x00;
+		while (++_x < _width)
+		{
+			if ((_x & 7) == 0)
+			{
+				bits = pgm_read_byte(_data + (_x >> 3));
+				if (bits == sameByte && _x + 8 <= _width)
+				{
+					_x += 7;	// the whole byte continues the run
+					continue;
+				}
+			}
+			else
+				bits <<= 1;
+			if (((bits & 0x80) != 0) != set)
+				break;
+		}
+		length = _x - start;
+		return true;
+	}
+
+	// moves past the row and the rows identical to it
+	void nextRow() {
+		if (_rle)
+		{
+			_data++;
+			for (uint16_t x = 0; x < _width; x += readByte(_data++));
+			_run = _data + 1;
+			_set = false;
+		}
+		else
+			_data += (_width + 7) >> 3;
+		_x = 0;
+	}
+
+private:
+	uint8_t readByte(const uint8_t *p) {
+		return _isInRAM ? *p : pgm_read_byte(p);
+	}
+
+	const uint8_t *_data;
+	uint16_t _width;
+	uint16_t _x;
+	bool _rle;
+	bool _set;
+	bool _isInRAM;	// runs of the glyph cache
+	const uint8_t *_run;
+};
+
+// Draws a glyph of an extended font or of the glyph cache. Its rows are read as runs of set and unset pixels,
+// identical rows of an RLE glyph are drawn as one row as tall as all of them.
+// In solid mode the whole visible part of the glyph is one address window that the runs are written into
+// row by row, a scaled row is sent once and repeated from the scanline.
+// In transparent mode each run of set pixels is one rectangle as tall as the scaled row.
+void ILI9341_due::drawExtendedChar(const uint8_t *data, uint8_t encoding, bool isInRAM, uint16_t charWidth, uint16_t charHeight)
+{
+	if (_letterSpacing > 0 && !_isFirstChar)
+	{
+		if (_fontMode == gTextFontModeSolid)
+		{
+#ifdef LINE_SPACING_AS_PART_OF_LETTERS
+			fillRect(_x, _y, _letterSpacing * _textScale, (charHeight + _lineSpacing)*_textScale, _fontBgColor);
+#else
+			fillRect(_x, _y, _letterSpacing * _textScale, charHeight *_textScale, _fontBgColor);
+#endif
+		}
+		_x += _letterSpacing * _textScale;
+	}
+	_isFirstChar = false;
+
+#ifdef LINE_SPACING_AS_PART_OF_LETTERS
+	if (_fontMode == gTextFontModeSolid && _lineSpacing > 0) {
+		fillRect(_x, _y + charHeight*_textScale, charWidth * _textScale, _lineSpacing *_textScale, _fontBgColor);
+	}
+#endif
+
+	const int16_t visibleX1 = max(_x, _clip.x1);
+	const int16_t visibleX2 = min(_x + (int16_t)(charWidth * _textScale), _clip.x2);
+	const int16_t visibleY1 = max(_y, _clip.y1);
+	const int16_t visibleY2 = min(_y + (int16_t)(charHeight * _textScale), _clip.y2);
+	if (visibleX1 >= visibleX2 || visibleY1 >= visibleY2)
+	{
+		_x += charWidth * _textScale;
+		return;
+	}
+
+	GlyphRunReader reader(data, charWidth, encoding, isInRAM);
+
+	const uint16_t rowPixels = visibleX2 - visibleX1;
+	bool set;
+	uint16_t length;
+
+	enableCS();
+	if (_fontMode == gTextFontModeSolid)
+	{
+		setAddrAndRW_cont(visibleX1, visibleY1, rowPixels, visibleY2 - visibleY1);
+		setDCForData();
+	}
+	else
+		fillScanline16(_fontColor);	//pre-fill the scanline, we will be drawing different lenghts of it
+
+	uint8_t rows;
+	for (uint16_t row = 0; row < charHeight; row += rows, reader.nextRow())
+	{
+		rows = reader.rowCount();
+		const int16_t rowY1 = max(_y + (int16_t)(row * _textScale), visibleY1);
+		const int16_t rowY2 = min(_y + (int16_t)((row + rows) * _textScale), visibleY2);
+		if (rowY1 >= rowY2)
+			continue;
+
+		if (_fontMode == gTextFontModeSolid)
+		{
+			uint16_t repeat = rowY2 - rowY1;
+			while (repeat > 0)
+			{
+				GlyphRunReader runs = reader;
+				uint16_t lineId = 0;
+				int16_t runX = _x;
+				while (runs.nextRun(set, length))
+				{
+					int16_t x1 = max(runX, visibleX1);
+					runX += length * _textScale;
+					const int16_t x2 = min(runX, visibleX2);
+					const uint16_t color = set ? _fontColor : _fontBgColor;
+					for (; x1 < x2; x1++)
+					{
+						_scanline16[lineId++] = color;
+						if (lineId == SCANLINE_PIXEL_COUNT)
+						{
+							writeScanline16(lineId);
+							lineId = 0;
+						}
+					}
+				}
+				if (lineId > 0)
+					writeScanline16(lineId);
+				repeat--;
+
+				// the scanline still holds the whole row
+				if (rowPixels <= SCANLINE_PIXEL_COUNT)
+				{
+					for (; repeat > 0; repeat--)
+						writeScanline16(rowPixels);
+				}
+			}
+		}
+		else
+		{
+			GlyphRunReader runs = reader;
+			int16_t runX = _x;
+			while (runs.nextRun(set, length))
+			{
+				const int16_t x1 = max(runX, visibleX1);
+				runX += length * _textScale;
+				const int16_t x2 = min(runX, visibleX2);
+				if (set && x1 < x2)
+				{
+					setAddrAndRW_cont(x1, rowY1, x2 - x1, rowY2 - rowY1);
+					setDCForData();
+					writeScanlineLooped((uint32_t)(x2 - x1) * (uint32_t)(rowY2 - rowY1));
+				}
+			}
+		}
+	}
+	disableCS();	// to put CS line back up
+
+	_x += charWidth * _textScale;
+}
+
+#ifdef ILI_USE_GLYPH_CACHE
+// Returns the slot with c of the current font decoded to gTextGlyphRLE rows, decodes it into the least recently
+// used slot if it is not there. NULL if the glyph does not fit into a slot.
+// data is the glyph of an extended bitmap font, NULL for the old format where index is the offset of the glyph.
+// The runs do not depend on the text scale or colors so they are the same for all of them.
+iliGlyphCacheSlot* ILI9341_due::getCachedGlyph(uint8_t c, const uint8_t *data, uint16_t index, uint16_t charWidth, uint16_t charHeight)
+{
+	iliGlyphCacheSlot *slot = _glyphCache;
+	_glyphCacheClock++;
+	for (uint8_t i = 0; i < ILI_GLYPH_CACHE_SLOTS; i++)
+	{
+		iliGlyphCacheSlot &s = _glyphCache[i];
+		if (s.font == _font && s.c == c)
+		{
+			s.lastUse = _glyphCacheClock;
+			return s.size > 0 ? &s : NULL;
+		}
+		if (s.font == NULL || (uint16_t)(_glyphCacheClock - s.lastUse) > (uint16_t)(_glyphCacheClock - slot->lastUse))
+			slot = &s;
+		if (s.font == NULL)
+			break;
+	}
+
+	slot->font = _font;
+	slot->c = c;
+	slot->lastUse = _glyphCacheClock;
+	slot->size = 0;
+
+	GlyphRunReader reader(data ? data : _font + index, charWidth, gTextGlyphBitmap, false);	// rows of an extended font
+	uint16_t size = 0, rowStart = 0;
+	for (uint16_t y = 0; y < charHeight; y++, reader.nextRow())
+	{
+		if (size >= ILI_GLYPH_CACHE_SLOT_SIZE)
+			return NULL;
+		const uint16_t start = size;
+		slot->runs[size++] = 1;
+		bool set = false, runSet = false;
+		uint16_t length = 0;
+		for (uint16_t x = 0; x < charWidth; x += length)
+		{
+			if (data)
+				reader.nextRun(runSet, length);
+			else
+			{
+				// the old format stores columns of bytes, see drawSolidChar for the shift of the last byte
+				const uint8_t i = y >> 3;
+				const uint8_t shift = (charHeight > 8 && charHeight < (i + 1) * 8) ? ((i + 1) << 3) - charHeight : 0;
+				const uint8_t *column = _font + index + (uint16_t)i * charWidth;
+				runSet = (pgm_read_byte(column + x) >> shift >> (y & 7)) & 1;
+				for (length = 1; x + length < charWidth && ((pgm_read_byte(column + x + length) >> shift >> (y & 7)) & 1) == runSet; length++);
+			}
+			if (runSet != set)
+			{
+				if (size >= ILI_GLYPH_CACHE_SLOT_SIZE)
+					return NULL;
+				slot->runs[size++] = 0;	// the row starts with set pixels
+			}
+			if (size >= ILI_GLYPH_CACHE_SLOT_SIZE)
+				return NULL;
+			slot->runs[size++] = length;
+			set = !runSet;
+		}
+		// the same as the previous row, count it there
+		if (y > 0 && slot->runs[rowStart] < 255 && size - start == start - rowStart &&
+			memcmp(slot->runs + start + 1, slot->runs + rowStart + 1, size - start - 1) == 0)
+		{
+			slot->runs[rowStart]++;
+			size = start;
+		}
+		else
+			rowStart = start;
+	}
+	slot->size = size;
+	return slot;
+}
+#endif
+
+// Writes the digits of value in base so that they end with the terminating 0 at end - 1, puts a '.' before
+// the last decimals digits (adding leading zeros if needed). Returns the first digit, NULL if they do not fit
+// between start and end.
+static char* formatDigits(char *start, char *end, unsigned long value, uint8_t base, uint8_t decimals)
+{
+	if (base < 2 || base > 36)
+		base = 10;
+	char *p = end;
+	*--p = 0;
+	uint8_t count = 0;
+	do {
+		if (p - start < (decimals > 0 && count == decimals ? 2 : 1))
+			return NULL;
+		if (decimals > 0 && count == decimals)
+			*--p = '.';
+		const uint8_t digit = value % base;
+		*--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+		value /= base;
+		count++;
+	} while (value > 0 || count <= decimals);
+	return p;
+}
+
+// Copies the sign and the digits to buf right aligned in width chars, pad is put in front of them
+// (after the sign if pad is '0'). buf is filled with '#' if they do not fit or digits is NULL.
+static char* formatPadded(char *buf, uint8_t size, bool negative, const char *digits, uint8_t width, char pad)
+{
+	if (size == 0)
+		return buf;
+	const uint8_t digitCount = digits ? strlen(digits) : 0;
+	const uint8_t length = max((uint8_t)(digitCount + negative), width);
+	if (digits == NULL || length + 1 > size)
+	{
+		memset(buf, '#', size - 1);
+		buf[size - 1] = 0;
+		return buf;
+	}
+	// the digits can be at the end of buf
+	memmove(buf + length - digitCount, digits, digitCount + 1);
+	char *p = buf;
+	if (negative && pad == '0')
+		*p++ = '-';
+	while (p < buf + length - digitCount - (negative && pad != '0' ? 1 : 0))
+		*p++ = pad;
+	if (negative && pad != '0')
+		*p++ = '-';
+	return buf;
+}
+
+char* ILI9341_due::formatInt(char *buf, uint8_t size, long value, uint8_t width, char pad)
+{
+	return formatFixed(buf, size, value, 0, width, pad);
+}
+
+char* ILI9341_due::formatFixed(char *buf, uint8_t size, long value, uint8_t decimals, uint8_t width, char pad)
+{
+	char digits[24];
+	return formatPadded(buf, size, value < 0,
+		formatDigits(digits, digits + sizeof(digits), value < 0 ? 0 - (unsigned long)value : value, 10, decimals), width, pad);
+}
+
+char* ILI9341_due::formatFloat(char *buf, uint8_t size, double value, uint8_t decimals, uint8_t width, char pad)
+{
+	// the same digits as Print::print(double) prints
+	if (isnan(value))
+		return formatPadded(buf, size, false, "nan", width, ' ');
+	if (isinf(value))
+		return formatPadded(buf, size, false, "inf", width, ' ');
+	if (value > 4294967040.0 || value < -4294967040.0)
+		return formatPadded(buf, size, false, "ovf", width, ' ');
+
+	const bool negative = value < 0.0;
+	if (negative)
+		value = -value;
+	double rounding = 0.5;
+	for (uint8_t i = 0; i < decimals; i++)
+		rounding /= 10.0;
+	value += rounding;
+
+	char digits[32];
+	const unsigned long intPart = (unsigned long)value;
+	double remainder = value - (double)intPart;
+	char *first = formatDigits(digits, digits + 11, intPart, 10, 0);	// up to 10 digits
+	char *p = digits + 10;
+	if (decimals > 0)
+	{
+		if (decimals > sizeof(digits) - 12)
+			first = NULL;
+		else
+		{
+			*p++ = '.';
+			while (decimals-- > 0)
+			{
+				remainder *= 10.0;
+				const uint8_t digit = (uint8_t)remainder;
+				*p++ = '0' + digit;
+				remainder -= digit;
+			}
+			*p = 0;
+		}
+	}
+	return formatPadded(buf, size, negative, first, width, pad);
+}
+
 size_t ILI9341_due::print(char c) {
 	_isFirstChar = true;
 	beginTransaction();
@@ -2367,45 +4249,33 @@ size_t ILI9341_due::print(char c) {
 	return 0;
 }
 size_t ILI9341_due::print(unsigned char c, int b) {
-	_isFirstChar = true;
-	beginTransaction();
-	Print::print(c, b);
-	endTransaction();
-	return 0;
+	return print((unsigned long)c, b);
 }
 size_t ILI9341_due::print(int d, int b) {
-	_isFirstChar = true;
-	beginTransaction();
-	Print::print(d, b);
-	endTransaction();
-	return 0;
+	return print((long)d, b);
 }
 size_t ILI9341_due::print(unsigned int u, int b) {
-	_isFirstChar = true;
-	beginTransaction();
-	Print::print(u, b);
-	endTransaction();
-	return 0;
+	return print((unsigned long)u, b);
 }
 size_t ILI9341_due::print(long l, int b) {
-	_isFirstChar = true;
-	beginTransaction();
-	Print::print(l, b);
-	endTransaction();
+	if (b == 0)
+		return print((char)l);
+	// negative numbers in other bases than 10 are printed as unsigned ones (the same as Print does)
+	char text[sizeof(long) * 8 + 2];	// binary digits, the sign and the terminating 0
+	const bool negative = b == 10 && l < 0;
+	print(formatPadded(text, sizeof(text), negative, formatDigits(text, text + sizeof(text), negative ? 0 - (unsigned long)l : l, b, 0), 0, ' '));
 	return 0;
 }
 size_t ILI9341_due::print(unsigned long ul, int b) {
-	_isFirstChar = true;
-	beginTransaction();
-	Print::print(ul, b);
-	endTransaction();
+	if (b == 0)
+		return print((char)ul);
+	char text[sizeof(long) * 8 + 1];	// binary digits and the terminating 0
+	print(formatDigits(text, text + sizeof(text), ul, b, 0));
 	return 0;
 }
 size_t ILI9341_due::print(double d, int b) {
-	_isFirstChar = true;
-	beginTransaction();
-	Print::print(d, b);
-	endTransaction();
+	char text[32];
+	print(formatFloat(text, sizeof(text), d, b));
 	return 0;
 }
 size_t ILI9341_due::print(const Printable& str) {
@@ -2445,46 +4315,28 @@ size_t ILI9341_due::println(char c) {
 	return 0;
 }
 size_t ILI9341_due::println(unsigned char c, int b) {
-	_isFirstChar = true;
-	beginTransaction();
-	Print::println(c, b);
-	endTransaction();
-	return 0;
+	print(c, b);
+	return println();
 }
 size_t ILI9341_due::println(int d, int b) {
-	_isFirstChar = true;
-	beginTransaction();
-	Print::println(d, b);
-	endTransaction();
-	return 0;
+	print(d, b);
+	return println();
 }
 size_t ILI9341_due::println(unsigned int u, int b) {
-	_isFirstChar = true;
-	beginTransaction();
-	Print::println(u, b);
-	endTransaction();
-	return 0;
+	print(u, b);
+	return println();
 }
 size_t ILI9341_due::println(long l, int b) {
-	_isFirstChar = true;
-	beginTransaction();
-	Print::println(l, b);
-	endTransaction();
-	return 0;
+	print(l, b);
+	return println();
 }
 size_t ILI9341_due::println(unsigned long ul, int b) {
-	_isFirstChar = true;
-	beginTransaction();
-	Print::println(ul, b);
-	endTransaction();
-	return 0;
+	print(ul, b);
+	return println();
 }
 size_t ILI9341_due::println(double d, int b) {
-	_isFirstChar = true;
-	beginTransaction();
-	Print::println(d, b);
-	endTransaction();
-	return 0;
+	print(d, b);
+	return println();
 }
 size_t ILI9341_due::println(const Printable& str) {
 	_isFirstChar = true;
@@ -2503,6 +4355,7 @@ size_t ILI9341_due::println(void) {
 
 size_t ILI9341_due::print(const char *str)
 {
+	ILI_STATS_SCOPE(iliStatsText);
 	beginTransaction();
 	_isFirstChar = true;
 	while (*str)
@@ -2517,6 +4370,7 @@ size_t ILI9341_due::print(const char *str)
 
 size_t ILI9341_due::print(const String &str)
 {
+	ILI_STATS_SCOPE(iliStatsText);
 	beginTransaction();
 	_isFirstChar = true;
 	for (uint16_t i = 0; i < str.length(); i++)
@@ -2530,6 +4384,7 @@ size_t ILI9341_due::print(const String &str)
 
 size_t ILI9341_due::print(const __FlashStringHelper *str)
 {
+	ILI_STATS_SCOPE(iliStatsText);
 	beginTransaction();
 	_isFirstChar = true;
 	PGM_P p = reinterpret_cast<PGM_P>(str);
@@ -2954,8 +4809,247 @@ void ILI9341_due::printAlignedPivotedOffseted(const __FlashStringHelper *str, gT
 	clearPixelsOnRight(pixelsClearedOnRight);
 }
 
+// top left corner of a text field with the text width pixels wide
+static void getTextFieldOrigin(const gTextField &field, int16_t width, int16_t &x, int16_t &y)
+{
+	const int16_t height = ILI9341_due::getFontHeight(field.font) * field.textScale;
+	x = field.x;
+	y = field.y;
+	if (field.pivot == gTextPivotTopCenter || field.pivot == gTextPivotMiddleCenter || field.pivot == gTextPivotBottomCenter)
+		x -= width / 2;
+	else if (field.pivot == gTextPivotTopRight || field.pivot == gTextPivotMiddleRight || field.pivot == gTextPivotBottomRight)
+		x -= width;
+	if (field.pivot == gTextPivotMiddleLeft || field.pivot == gTextPivotMiddleCenter || field.pivot == gTextPivotMiddleRight)
+		y -= height / 2;
+	else if (field.pivot == gTextPivotBottomLeft || field.pivot == gTextPivotBottomCenter || field.pivot == gTextPivotBottomRight)
+		y -= height;
+}
+
+void ILI9341_due::initTextField(gTextField &field, int16_t x, int16_t y, gTextPivot pivot)
+{
+	field.font = _font;
+	field.textScale = _textScale;
+	field.letterSpacing = _letterSpacing;
+	field.x = _area.x + x;
+	field.y = _area.y + y;
+	field.pivot = pivot == gTextPivotDefault ? gTextPivotTopLeft : pivot;
+	field.length = 0;
+	field.x1 = field.x2 = field.x;
+}
+
+void ILI9341_due::printTextField(gTextField &field, const char *str)
+{
+	ILI_STATS_SCOPE(iliStatsText);
+	const gTextFont font = _font;
+	const gTextFontMode fontMode = _fontMode;
+	const uint8_t letterSpacing = _letterSpacing;
+	_font = field.font;
+	_fontMode = gTextFontModeSolid;
+	_letterSpacing = field.letterSpacing;
+#ifdef TEXT_SCALING_ENABLED
+	const uint8_t textScale = _textScale;
+	_textScale = field.textScale;
+#endif
+
+	// where the glyphs start and end, chars the font does not have take no room (like in write)
+	int16_t charX[GTEXT_FIELD_MAX_CHARS], charEnd[GTEXT_FIELD_MAX_CHARS];
+	const int16_t spacing = _letterSpacing * _textScale;
+	int16_t width = 0;
+	uint8_t length = 0;
+	bool isFirstChar = true;
+	for (; length < GTEXT_FIELD_MAX_CHARS && (uint8_t)str[length] >= 0x20; length++)
+	{
+		const bool isInFont = isCharInFont(str[length], _font);
+		if (isInFont && !isFirstChar)
+			width += spacing;
+		charX[length] = width;
+		width += getCharWidth(str[length]);
+		charEnd[length] = width;
+		if (isInFont)
+			isFirstChar = false;
+	}
+	int16_t x, y;
+	getTextFieldOrigin(field, width, x, y);
+	for (uint8_t i = 0; i < length; i++)
+	{
+		charX[i] += x;
+		charEnd[i] += x;
+	}
+
+	const bool isRedrawn = field.length == 0 || field.color != _fontColor || field.bgColor != _fontBgColor;
+	bool isChanged[GTEXT_FIELD_MAX_CHARS];
+	for (uint8_t i = 0; i < length; i++)
+		isChanged[i] = isRedrawn || i >= field.length || field.text[i] != str[i] || field.charX[i] != charX[i];
+
+	beginTransaction();
+	const int16_t height = scaledFontHeight();
+	const int16_t shownY = scrolledY(y);
+
+	// pixels of the previous text outside of the new one
+	if (field.length > 0)
+	{
+		if (field.x1 < x)
+			fillRect(field.x1, shownY, min(field.x2, x) - field.x1, height, _fontBgColor);
+		if (field.x2 > x + width)
+		{
+			const int16_t clearX1 = max(field.x1, (int16_t)(x + width));
+			fillRect(clearX1, shownY, field.x2 - clearX1, height, _fontBgColor);
+		}
+	}
+
+	// the changed glyphs and the letter spacing around them
+	for (uint8_t i = 0; i < length; i++)
+	{
+		if (!isChanged[i])
+			continue;
+		if (i > 0 && charX[i] > charEnd[i - 1])
+			fillRect(charEnd[i - 1], shownY, charX[i] - charEnd[i - 1], height, _fontBgColor);
+		if (i + 1 < length && !isChanged[i + 1] && charX[i + 1] > charEnd[i])
+			fillRect(charEnd[i], shownY, charX[i + 1] - charEnd[i], height, _fontBgColor);
+		_x = charX[i];
+		_y = y;
+		_isFirstChar = true;
+		write((uint8_t)str[i]);
+	}
+	endTransaction();
+
+	field.length = length;
+	memcpy(field.text, str, length);
+	memcpy(field.charX, charX, length * sizeof(int16_t));
+	field.x1 = x;
+	field.x2 = x + width;
+	field.color = _fontColor;
+	field.bgColor = _fontBgColor;
+
+	_x = x + width;
+	_y = y;
+	_font = font;
+	_fontMode = fontMode;
+	_letterSpacing = letterSpacing;
+#ifdef TEXT_SCALING_ENABLED
+	_textScale = textScale;
+#endif
+}
+
+void ILI9341_due::clearTextField(gTextField &field)
+{
+	ILI_STATS_SCOPE(iliStatsText);
+	if (field.length > 0)
+	{
+		int16_t x, y;
+		getTextFieldOrigin(field, field.x2 - field.x1, x, y);
+		fillRect(field.x1, scrolledY(y), field.x2 - field.x1, getFontHeight(field.font) * field.textScale, _fontBgColor);
+	}
+	field.length = 0;
+	field.x1 = field.x2 = field.x;
+}
+
+uint16_t ILI9341_due::layoutText(gTextLayout &layout, const char *text)
+{
+	layout.text = text;
+	layout.font = _font;
+	layout.textScale = _textScale;
+	layout.letterSpacing = _letterSpacing;
+	layout.lineSpacing = _lineSpacing;
+	layout.areaW = _area.w;
+	layout.areaH = _area.h;
+	layout.lineCount = 0;
+	if (_font == 0)
+		return 0;
+
+	const int16_t spacing = _letterSpacing * _textScale;
+	const uint16_t lineHeight = (getFontHeight() + _lineSpacing) * _textScale;
+	uint16_t pos = 0;
+	while (text[pos] != 0 && layout.lineCount < GTEXT_LAYOUT_MAX_LINES &&
+		(layout.lineCount == 0 || (layout.lineCount + 1) * lineHeight - _lineSpacing * _textScale <= _area.h))
+	{
+		const uint16_t start = pos;
+		uint16_t width = 0, end = 0;
+		uint16_t breakAt = 0, breakWidth = 0;	// the last run of spaces in the line, 0 if there is none
+		bool isFirstChar = true;
+		for (;; pos++)
+		{
+			const uint8_t c = text[pos];
+			if (c == 0 || c == '\n')
+			{
+				end = pos;
+				if (c == '\n')
+					pos++;
+				break;
+			}
+			const bool isInFont = isCharInFont(c, _font);
+			const uint16_t advance = isInFont ? getCharWidth(c) + (isFirstChar ? 0 : spacing) : 0;
+			if (c == ' ' && pos > start && text[pos - 1] != ' ')
+			{
+				breakAt = pos;
+				breakWidth = width;
+			}
+			if (width + advance > _area.w && pos > start)
+			{
+				if (breakAt > start)
+				{
+					end = breakAt;
+					width = breakWidth;
+					pos = breakAt;
+				}
+				else
+					end = pos;	// the word does not fit on a line by itself
+				while (text[pos] == ' ')
+					pos++;
+				break;
+			}
+			width += advance;
+			if (isInFont)
+				isFirstChar = false;
+		}
+		layout.lineStart[layout.lineCount] = start;
+		layout.lineLength[layout.lineCount] = end - start;
+		layout.lineWidth[layout.lineCount] = width;
+		layout.lineCount++;
+	}
+	return pos;
+}
+
+void ILI9341_due::printLayout(gTextLayout &layout, gTextAlign align)
+{
+	ILI_STATS_SCOPE(iliStatsText);
+	if (layout.font != _font || layout.textScale != _textScale || layout.letterSpacing != _letterSpacing ||
+		layout.lineSpacing != _lineSpacing || layout.areaW != _area.w || layout.areaH != _area.h)
+		layoutText(layout, layout.text);
+	if (layout.lineCount == 0)
+		return;
+
+	const uint16_t lineHeight = (getFontHeight() + _lineSpacing) * _textScale;
+	const uint16_t height = layout.lineCount * lineHeight - _lineSpacing * _textScale;
+	int16_t y = _area.y;
+	if (align == gTextAlignMiddleLeft || align == gTextAlignMiddleCenter || align == gTextAlignMiddleRight)
+		y += ((int16_t)_area.h - (int16_t)height) / 2;
+	else if (align == gTextAlignBottomLeft || align == gTextAlignBottomCenter || align == gTextAlignBottomRight)
+		y += (int16_t)_area.h - (int16_t)height;
+
+	beginTransaction();
+	for (uint8_t line = 0; line < layout.lineCount; line++, y += lineHeight)
+	{
+		_x = _area.x;
+		if (align == gTextAlignTopCenter || align == gTextAlignMiddleCenter || align == gTextAlignBottomCenter)
+			_x += ((int16_t)_area.w - (int16_t)layout.lineWidth[line]) / 2;
+		else if (align == gTextAlignTopRight || align == gTextAlignMiddleRight || align == gTextAlignBottomRight)
+			_x += (int16_t)_area.w - (int16_t)layout.lineWidth[line];
+		_y = y;
+		_isFirstChar = true;
+		const char *str = layout.text + layout.lineStart[line];
+		for (uint16_t i = 0; i < layout.lineLength[line]; i++)
+		{
+			if ((uint8_t)str[i] >= 0x20)
+				write((uint8_t)str[i]);
+		}
+	}
+	endTransaction();
+}
+
 __attribute__((always_inline))
 void ILI9341_due::clearPixelsOnLeft(uint16_t pixelsToClearOnLeft) {
+	ILI_STATS_SCOPE(iliStatsText);
 	// CLEAR PIXELS ON THE LEFT
 	if (pixelsToClearOnLeft > 0)
 	{
@@ -2968,6 +5062,7 @@ void ILI9341_due::clearPixelsOnLeft(uint16_t pixelsToClearOnLeft) {
 
 __attribute__((always_inline))
 void ILI9341_due::clearPixelsOnRight(uint16_t pixelsToClearOnRight) {
+	ILI_STATS_SCOPE(iliStatsText);
 	// CLEAR PIXELS ON THE RIGHT
 	if (pixelsToClearOnRight > 0)
 	{
@@ -3220,7 +5315,7 @@ void ILI9341_due::cursorTo(uint8_t column, uint8_t row)
 	* Text position is relative to current text area
 	*/
 
-	_x = _xStart = _area.x + column * (pgm_read_byte(_font + GTEXT_FONT_FIXED_WIDTH) + 1);
+	_x = _xStart = _area.x + column * (getFontColumnWidth(_font) + 1);
 	_y = _yStart = _area.y + row * (getFontHeight() + _lineSpacing) * _textScale;
 	_isFirstChar = true;
 	//#ifndef GLCD_NODEFER_SCROLL
@@ -3240,9 +5335,9 @@ void ILI9341_due::cursorTo(int8_t column)
 	* negative value moves the cursor backwards
 	*/
 	if (column >= 0)
-		_x = _xStart = column * (pgm_read_byte(_font + GTEXT_FONT_FIXED_WIDTH) + 1) + _area.x;
+		_x = _xStart = column * (getFontColumnWidth(_font) + 1) + _area.x;
 	else
-		_x -= column * (pgm_read_byte(_font + GTEXT_FONT_FIXED_WIDTH) + 1);
+		_x -= column * (getFontColumnWidth(_font) + 1);
 
 	_isFirstChar = true;
 
@@ -3283,6 +5378,7 @@ void ILI9341_due::setTextScale(uint8_t s) {
 
 void ILI9341_due::eraseTextLine(uint16_t color, gTextEraseLine type)
 {
+	ILI_STATS_SCOPE(iliStatsText);
 	/*int16_t x = _x;
 	int16_t y = _y;
 	int16_t height = getFontHeight();*/
@@ -3306,6 +5402,7 @@ void ILI9341_due::eraseTextLine(uint16_t color, gTextEraseLine type)
 
 void ILI9341_due::eraseTextLine(uint16_t color, uint8_t row)
 {
+	ILI_STATS_SCOPE(iliStatsText);
 	cursorTo(0, row);
 	eraseTextLine(color, gTextEraseToEOL);
 }
@@ -3363,8 +5460,15 @@ uint16_t ILI9341_due::getCharWidth(uint8_t c)
 {
 	int16_t width = 0;
 
-	if (isFixedWidthFont(_font) {
-		width = (pgm_read_byte(_font + GTEXT_FONT_FIXED_WIDTH)) * _textScale;
+	if (isExtendedFont(_font)) {
+		const uint8_t *glyph = getExtendedGlyph(c, _font);
+		if (glyph)
+			width = pgm_read_byte(glyph) * _textScale;
+	}
+	else if (isFixedWidthFont(_font) {
+		// chars the font does not have are not drawn (see write)
+		if (c >= pgm_read_byte(_font + GTEXT_FONT_FIRST_CHAR) && c - pgm_read_byte(_font + GTEXT_FONT_FIRST_CHAR) < pgm_read_byte(_font + GTEXT_FONT_CHAR_COUNT))
+			width = (pgm_read_byte(_font + GTEXT_FONT_FIXED_WIDTH)) * _textScale;
 	}
 	else {
 		// variable width font 
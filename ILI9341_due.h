@@ -123,10 +123,15 @@ MIT license, all text above must be included in any redistribution
 #define ILI9341_RAMRD   0x2E
 
 #define ILI9341_PTLAR   0x30
+#define ILI9341_VSCRDEF 0x33
+#define ILI9341_TEOFF   0x34
+#define ILI9341_TEON    0x35
 #define ILI9341_MADCTL  0x36
+#define ILI9341_VSCRSADD 0x37
 #define ILI9341_IDMOFF  0x38
 #define ILI9341_IDMON   0x39
 #define ILI9341_PIXFMT  0x3A
+#define ILI9341_GETSCAN 0x45
 
 #define ILI9341_FRMCTR1 0xB1
 #define ILI9341_FRMCTR2 0xB2
@@ -313,6 +318,31 @@ typedef enum  {
 // zero length is flag indicating fixed width font (array does not contain width data entries)
 #define isFixedWidthFont(font)  (pgm_read_byte(font+GTEXT_FONT_LENGTH) == 0 && pgm_read_byte(font+GTEXT_FONT_LENGTH+1) == 0))
 
+// extended font (ILIFontCompiler creates it), all numbers little endian:
+//   header: 0, 0, 0 (a fixed width font 0 pixels wide, which no font of the old format is), height, version,
+//           gTextGlyphEncoding, column width (for cursorTo and setTextArea with columns), number of ranges,
+//           number of glyphs (16 bit)
+//   ranges: first code, number of codes, index of the glyph of the first code (16 bit)
+//   glyphs: width, offset of the glyph data from the end of the glyph table (24 bit)
+//   data:   the glyphs row by row, see gTextGlyphEncoding
+#define GTEXT_XFONT_VERSION		4
+#define GTEXT_XFONT_ENCODING		5
+#define GTEXT_XFONT_COLUMN_WIDTH	6
+#define GTEXT_XFONT_RANGE_COUNT	7
+#define GTEXT_XFONT_GLYPH_COUNT	8
+#define GTEXT_XFONT_RANGES		10
+#define GTEXT_XFONT_RANGE_SIZE	4
+#define GTEXT_XFONT_GLYPH_SIZE	4
+
+typedef enum {
+	gTextGlyphBitmap = 0,	// each row in (width + 7) / 8 bytes, the leftmost pixel in the top bit
+	gTextGlyphRLE = 1	// each row: number of identical rows it stands for (1-255), then the lengths of the runs
+				// of unset and set pixels, starting with unset (0 if the row starts with a set pixel),
+				// up to the width
+} gTextGlyphEncoding;
+
+#define isExtendedFont(font)  (pgm_read_byte(font+GTEXT_FONT_LENGTH) == 0 && pgm_read_byte(font+GTEXT_FONT_LENGTH+1) == 0 && pgm_read_byte(font+GTEXT_FONT_FIXED_WIDTH) == 0)
+
 typedef enum  {
 	gTextAlignTopLeft,
 	gTextAlignTopCenter,
@@ -354,6 +384,39 @@ typedef struct
 
 typedef const uint8_t* gTextFont;
 
+// one line of text at a fixed position, printTextField redraws only the glyphs that changed
+typedef struct
+{
+	gTextFont font;
+	uint8_t textScale;
+	uint8_t letterSpacing;
+	int16_t x;				// the pivot point of the text on the screen
+	int16_t y;
+	gTextPivot pivot;
+	uint16_t color;			// colors the text on the screen was drawn with
+	uint16_t bgColor;
+	uint8_t length;			// chars on the screen
+	int16_t x1, x2;			// the text on the screen spans from x1 to x2 - 1 (letter spacing included)
+	char text[GTEXT_FIELD_MAX_CHARS];
+	int16_t charX[GTEXT_FIELD_MAX_CHARS];	// where the glyphs on the screen start
+} gTextField;
+
+// lines of a paragraph broken to fit the text area (layoutText), printLayout draws them without measuring again
+typedef struct
+{
+	const char *text;		// not copied, has to stay as it is while the layout is used
+	gTextFont font;			// the layout is made again when one of these changes
+	uint8_t textScale;
+	uint8_t letterSpacing;
+	uint8_t lineSpacing;
+	uint16_t areaW;
+	uint16_t areaH;
+	uint8_t lineCount;
+	uint16_t lineStart[GTEXT_LAYOUT_MAX_LINES];		// index of the first char of the line in text
+	uint16_t lineLength[GTEXT_LAYOUT_MAX_LINES];	// chars
+	uint16_t lineWidth[GTEXT_LAYOUT_MAX_LINES];		// pixels
+} gTextLayout;
+
 typedef enum {
 	iliRotation0 = 0,
 	iliRotation90 = 1,
@@ -373,6 +436,182 @@ typedef enum {
 	pwrLevelSleep = 3
 } pwrLevel;
 
+// a rectangle of one color waiting in the deferred queue (lines and pixels are 1 pixel wide/high rectangles)
+typedef struct
+{
+	int16_t x;
+	int16_t y;
+	uint16_t w;
+	uint16_t h;
+	uint16_t color;
+} iliSpan;
+
+#ifdef ILI_USE_GLYPH_CACHE
+// a glyph decoded to gTextGlyphRLE rows in RAM
+typedef struct
+{
+	gTextFont font;		// NULL if the slot is free
+	uint8_t c;			// char code, minus the first char of the font for the old format
+	uint16_t size;		// bytes of runs, 0 if the glyph does not fit into the slot and is drawn uncached
+	uint16_t lastUse;
+	uint8_t runs[ILI_GLYPH_CACHE_SLOT_SIZE];
+} iliGlyphCacheSlot;
+#endif
+
+// clipping bounds, x2 and y2 are exclusive
+typedef struct
+{
+	int16_t x1;
+	int16_t y1;
+	int16_t x2;
+	int16_t y2;
+} iliClipRect;
+
+// image pack (ILIPack creates it): a hash table of images followed by their pixels, all little endian
+//   header: "ILPK", version (16 bit), number of slots (16 bit, power of 2), number of images (16 bit), 2 bytes reserved
+//   slots:  ILI_PACK_SLOT_SIZE bytes each, an image is in the slot packHash(name) & (slots - 1) or in one of the next ones
+//   images: each starts at a multiple of the alignment given to ILIPack
+#define ILI_PACK_HEADER_SIZE 12
+#define ILI_PACK_SLOT_SIZE 20
+#define ILI_PACK_VERSION 1
+
+typedef enum {
+	iliPackRaw,		// RGB565 pixels (drawImage)
+	iliPackRLE,		// RLE packets (drawImageRLE)
+	iliPackIndexed,	// palette followed by the indexes (drawIndexedImage)
+	iliPackEmpty = 0xFF	// unused slot
+} iliPackFormat;
+
+// one slot of the pack
+typedef struct
+{
+	uint32_t hash;			// packHash of the name
+	uint8_t format;			// iliPackFormat
+	uint8_t bitsPerPixel;	// of the indexes (iliPackIndexed)
+	uint16_t w;
+	uint16_t h;
+	uint16_t paletteSize;	// colors in the palette (iliPackIndexed)
+	uint32_t offset;		// of the image from the start of the pack
+	uint32_t size;			// bytes
+} iliPackEntry;
+
+// screenshot frame (screenshot function), all numbers little endian:
+//   header: "ILSS", version (8 bit), iliScreenshotFormat (8 bit), width (16 bit), height (16 bit)
+//   rows:   ILI_SCREENSHOT_ROW_SAME (the row did not change since the previous frame)
+//           or ILI_SCREENSHOT_ROW_RUNS followed by runs adding up to width pixels,
+//           run: pixel count - 1 (8 bit), color (RGB565 16 bit, or red, green, blue with 6 bits each in the upper bits)
+//   end:    CRC-32 (the one of zip/PNG) of everything after "ILSS"
+#define ILI_SCREENSHOT_VERSION 1
+#define ILI_SCREENSHOT_ROW_SAME 0
+#define ILI_SCREENSHOT_ROW_RUNS 1
+
+typedef enum {
+	iliScreenshot565,	// 2 bytes per run color
+	iliScreenshot666	// 3 bytes per run color, all the bits the display keeps
+} iliScreenshotFormat;
+
+#ifdef ILI_USE_STATS
+// kinds of drawing functions the bus traffic is counted for
+typedef enum {
+	iliStatsOther,	// everything else (begin, setRotation, scrolling, endDeferred,...)
+	iliStatsPixel,	// drawPixel
+	iliStatsLine,	// drawLine, drawFastHLine, drawFastVLine, drawLineByAngle
+	iliStatsRect,	// drawRect
+	iliStatsFillRect,	// fillScreen, fillRect, fillRectWithShader
+	iliStatsCircle,	// drawCircle
+	iliStatsFillCircle,	// fillCircle
+	iliStatsTriangle,	// drawTriangle
+	iliStatsFillTriangle,	// fillTriangle
+	iliStatsRoundRect,	// drawRoundRect
+	iliStatsFillRoundRect,	// fillRoundRect
+	iliStatsArc,	// fillArc (arcs are always drawn filled)
+	iliStatsImage,	// images, sprites, bitmaps, pushColors
+	iliStatsText,	// print, write and clearing around text
+	iliStatsRead,	// readPixel, readRect, screenshotToConsole
+	iliStatsPrimitiveCount
+} iliStatsPrimitive;
+
+typedef struct
+{
+	uint32_t calls;			// calls of the drawing functions (calls made inside of them are not counted)
+	uint32_t bytes;			// all bytes written
+	uint32_t commandBytes;	// bytes written with DC low
+	uint32_t pixelBytes;	// bytes written after RAMWR
+	uint32_t readBytes;		// bytes read
+	uint32_t windowSets;	// CASET and PASET commands
+	uint32_t csToggles;		// CS going low (not counted in SPI_MODE_EXTENDED, SPI controller drives CS then)
+	uint32_t dcToggles;		// DC changing between command and data
+	uint32_t blocks;		// pixel buffers written in one transfer (each is a DMA transfer or a switch to 16 bit and back on Due)
+	uint32_t blockBytes;	// bytes written in these buffers
+	uint32_t dmaTransfers;	// DMA transfers started (SPI_MODE_DMA)
+	uint32_t waitCycles;	// CPU cycles spent waiting for DMA transfers to finish (SPI_MODE_DMA)
+} iliStats;
+
+// the ways the library drives the SPI bus, for estimating the time of the counted traffic
+typedef enum {
+	iliBusDueNormal,	// Due, SPI_MODE_NORMAL
+	iliBusDueExtended,	// Due, SPI_MODE_EXTENDED
+	iliBusDueDMA,		// Due, SPI_MODE_DMA
+	iliBusAVR			// Uno, Mega,... (SPDR and SPIF polling)
+} iliBusType;
+
+// what the bus costs in CPU cycles, see getBusTiming and estimateMicros
+typedef struct
+{
+	uint32_t cpuHz;				// CPU clock (F_CPU, 84MHz or 16MHz for a bus modelled on another board)
+	uint8_t divider;			// SCK = cpuHz / divider while writing, a byte takes 8 * divider cycles
+	uint8_t dividerRead;		// SCK = cpuHz / dividerRead while reading
+	uint8_t byteCycles;			// cycles between two single bytes on top of their 8 clocks (waiting for SPIF/RDRF, loading the next byte)
+	uint8_t blockByteCycles;	// the same for each byte of a buffer (0 with DMA)
+	uint16_t blockCycles;		// starting and finishing the transfer of a buffer (DMA setup, 8/16 bit switches)
+	uint8_t dcToggleCycles;		// setting DC
+	uint8_t csToggleCycles;		// setting CS low and back high
+} iliBusTiming;
+
+#define ILI_STATS_SCOPE(primitive) StatsScope statsScope(this, primitive)
+#define ILI_STATS_DC(command) countDC(command)
+#define ILI_STATS_WRITE8(c) countWrite8(c)
+#define ILI_STATS_WRITE(n) countWrite(n)
+#define ILI_STATS_BLOCK(n) countBlock(n)
+#define ILI_STATS_READ(n) _stats[_statsPrimitive].readBytes += (n)
+#define ILI_STATS_CS_LOW() countCSLow()
+#define ILI_STATS_CS_HIGH() _statsCSLow = false
+#define ILI_STATS_DMA() _stats[_statsPrimitive].dmaTransfers++
+#define ILI_STATS_WAIT_BEGIN() const uint32_t statsWaitStart = DWT->CYCCNT
+#define ILI_STATS_WAIT_END() _stats[_statsPrimitive].waitCycles += DWT->CYCCNT - statsWaitStart
+#else
+#define ILI_STATS_SCOPE(primitive)
+#define ILI_STATS_DC(command)
+#define ILI_STATS_WRITE8(c)
+#define ILI_STATS_WRITE(n)
+#define ILI_STATS_BLOCK(n)
+#define ILI_STATS_READ(n)
+#define ILI_STATS_CS_LOW()
+#define ILI_STATS_CS_HIGH()
+#define ILI_STATS_DMA()
+#define ILI_STATS_WAIT_BEGIN()
+#define ILI_STATS_WAIT_END()
+#endif
+
+#if SPI_MODE_DMA
+/** Use SAM3X DMAC if nonzero */
+#define ILI_USE_SAM3X_DMAC 1
+/** Use extra Bus Matrix arbitration fix if nonzero */
+#define ILI_USE_SAM3X_BUS_MATRIX_FIX 0
+/** Time in ms for DMA receive timeout */
+#define ILI_SAM3X_DMA_TIMEOUT 100
+/** chip select register number */
+#define ILI_SPI_CHIP_SEL 3
+/** DMAC receive channel */
+#define ILI_SPI_DMAC_RX_CH  1
+/** DMAC transmit channel */
+#define ILI_SPI_DMAC_TX_CH  0
+/** DMAC Channel HW Interface Number for SPI TX. */
+#define ILI_SPI_TX_IDX  1
+/** DMAC Channel HW Interface Number for SPI RX. */
+#define ILI_SPI_RX_IDX  2
+#endif
+
 #ifndef swap
 #define swap(a, b) { typeof(a) t = a; a = b; b = t; }
 #endif
@@ -399,20 +638,119 @@ protected:
 	float _arcAngleMax;
 	int16_t _angleOffset;
 
+	iliClipRect _clip;	// current clip rectangle, intersection of all the pushed ones
+	iliClipRect _clipStack[CLIP_STACK_DEPTH];
+	uint8_t _clipStackSize;
+	uint8_t _clipStackOverflow;	// pushes that did not fit on the stack, popped first
+
 	void fillArcOffsetted(uint16_t cx, uint16_t cy, uint16_t radius, uint16_t thickness, float startAngle, float endAngle, uint16_t color);
 
 	void drawFastVLine_cont_noFill(int16_t x, int16_t y, int16_t h, uint16_t color);
-	void drawFastVLine_noTrans(int16_t x, int16_t y, uint16_t h, uint16_t color);
-	void drawFastHLine_noTrans(int16_t x, int16_t y, uint16_t w, uint16_t color);
+	void drawFastVLine_noTrans(int16_t x, int16_t y, int16_t h, uint16_t color);
+	void drawFastHLine_noTrans(int16_t x, int16_t y, int16_t w, uint16_t color);
 	void drawLine_noTrans(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
 	void printHex8(uint8_t *data, uint8_t length);
 	void printHex16(uint16_t *data, uint8_t length);
 	void printHex32(uint32_t *data, uint8_t length);
 
 	uint8_t  _rst;
+	uint8_t  _te;	// pin connected to the TE output of the display, 255 if not connected
 	uint8_t _hiByte, _loByte;
 	bool _isIdle, _isInSleep;
-	uint16_t _color;
+	uint16_t _color;	// color the scanline was last filled with
+
+#ifdef ILI_USE_GLYPH_CACHE
+	iliGlyphCacheSlot _glyphCache[ILI_GLYPH_CACHE_SLOTS];
+	uint16_t _glyphCacheClock;
+	iliGlyphCacheSlot* getCachedGlyph(uint8_t c, const uint8_t *data, uint16_t index, uint16_t charWidth, uint16_t charHeight);
+#endif
+
+#ifdef ILI_USE_DEFERRED_SPANS
+	iliSpan _spans[DEFERRED_SPAN_QUEUE_SIZE];
+	uint16_t _spanCount;
+	bool _isDeferred;
+	void queueSpan(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+	void flushDeferred_noTrans();
+	void mergeSpans(bool vertical);
+#endif
+
+#ifdef ILI_USE_STATS
+	iliStats _stats[iliStatsPrimitiveCount];
+	iliStatsPrimitive _statsPrimitive;	// group the traffic is counted for now
+	bool _statsInCall;	// a drawing function is running, the ones it calls are not counted separately
+	bool _statsCommand;	// DC is low
+	bool _statsPixelData;	// the data written are pixels (after RAMWR)
+	bool _statsCSLow;
+
+	// counts the traffic for a group of drawing functions while it exists
+	class StatsScope
+	{
+	public:
+		StatsScope(ILI9341_due *tft, iliStatsPrimitive primitive) : _tft(tft), _isOutermost(!tft->_statsInCall) {
+			if (_isOutermost) {
+				_tft->_statsInCall = true;
+				_tft->_statsPrimitive = primitive;
+				_tft->_stats[primitive].calls++;
+			}
+		}
+		~StatsScope() {
+			if (_isOutermost) {
+				_tft->_statsInCall = false;
+				_tft->_statsPrimitive = iliStatsOther;
+			}
+		}
+	private:
+		ILI9341_due *_tft;
+		bool _isOutermost;
+	};
+
+	inline __attribute__((always_inline))
+		void countWrite8(uint8_t c) {
+		iliStats &stats = _stats[_statsPrimitive];
+		stats.bytes++;
+		if (_statsCommand) {
+			stats.commandBytes++;
+			if (c == ILI9341_CASET || c == ILI9341_PASET)
+				stats.windowSets++;
+			_statsPixelData = c == ILI9341_RAMWR;
+		}
+		else if (_statsPixelData) {
+			stats.pixelBytes++;
+		}
+	}
+
+	inline __attribute__((always_inline))
+		void countWrite(uint32_t n) {
+		_stats[_statsPrimitive].bytes += n;
+		if (_statsPixelData)
+			_stats[_statsPrimitive].pixelBytes += n;
+	}
+
+#ifdef ARDUINO_ARCH_AVR
+	static uint8_t avrClockDivider(uint8_t clockDiv);
+#endif
+
+	inline __attribute__((always_inline))
+		void countBlock(uint32_t n) {
+		countWrite(n);
+		_stats[_statsPrimitive].blocks++;
+		_stats[_statsPrimitive].blockBytes += n;
+	}
+
+	inline __attribute__((always_inline))
+		void countDC(bool command) {
+		if (command != _statsCommand)
+			_stats[_statsPrimitive].dcToggles++;
+		_statsCommand = command;
+	}
+
+	inline __attribute__((always_inline))
+		void countCSLow() {
+		if (!_statsCSLow)
+			_stats[_statsPrimitive].csToggles++;
+		_statsCSLow = true;
+	}
+#endif
 
 	uint16_t _scanline16[SCANLINE_PIXEL_COUNT];
 //#if SPI_MODE_DMA | SPI_MODE_EXTENDED
@@ -429,6 +767,7 @@ protected:
 #endif
 
 	uint8_t _spiClkDivider;
+	uint8_t _spiClkDividerRead;
 #ifdef ILI_USE_SPI_TRANSACTION
 	SPISettings _spiSettings;
 	uint8_t _transactionId;
@@ -465,6 +804,9 @@ protected:
 	uint8_t _letterSpacing;
 	uint8_t _lineSpacing;
 	bool _isFirstChar;
+	bool _textScroll;	// a new line at the bottom of the text area scrolls the area up
+	uint16_t _scrollHeight;	// height of the hardware scrolling area (whole lines), 0 if the area scrolls in software
+	uint16_t _scrollOffset;	// how many rows the hardware scrolling area is scrolled by
 	//bool _needScroll;
 	//bool _wrap;
 
@@ -473,15 +815,33 @@ protected:
 #else
 #define _textScale 1
 #endif
-	void fillRect_noTrans(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t color);
-	void fillRectWithShader_noTrans(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t(*fillShader)(uint16_t rx, uint16_t ry));
+	void fillRect_noTrans(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+	void fillRectWithShader_noTrans(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t(*fillShader)(uint16_t rx, uint16_t ry));
 	void drawCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t cornername, uint16_t color);
 	void fillCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t cornername, int16_t delta, uint16_t color);
 	void pushColors_noTrans_noCS(const uint16_t *colors, uint16_t offset, uint32_t len);
+	void writeSpriteRun_cont(const uint16_t *colors, int16_t x, int16_t y, int16_t len);
+	void writeRLEPixels_cont(const uint16_t *literal, uint16_t color, uint32_t count);
+	bool readRect_start(int16_t x, int16_t y, uint16_t w, uint16_t h);
+	bool testSPIClock(uint16_t *pattern, uint16_t *readBack);
+	void writeCalibrationPixels(uint16_t *colors);
 
 	void specialChar(uint8_t c);
 	void drawSolidChar(char c, uint16_t index, uint16_t charWidth, uint16_t charHeight);
 	void drawTransparentChar(char c, uint16_t index, uint16_t charWidth, uint16_t charHeight);
+	void drawExtendedChar(const uint8_t *data, uint8_t encoding, bool isInRAM, uint16_t charWidth, uint16_t charHeight);
+	void writeCharSpan_cont(int16_t y, int16_t h, int16_t w);
+	void scrollTextArea(uint16_t lineHeight);
+	void scrollTextAreaSoftware(uint16_t pixels);
+	void writeScrollArea();
+
+	// row of GRAM where the text line that is shown at y is drawn, the hardware scrolling moves them apart
+	__attribute__((always_inline))
+		int16_t scrolledY(int16_t y) {
+		if (_scrollOffset == 0 || y < (int16_t)_area.y || y >= (int16_t)(_area.y + _scrollHeight))
+			return y;
+		return _area.y + (y - _area.y + _scrollOffset) % _scrollHeight;
+	}
 	void applyPivot(const char *str, gTextPivot pivot, gTextAlign align);
 	void applyPivot(const String &str, gTextPivot pivot, gTextAlign align);
 	void applyPivot(const __FlashStringHelper *str, gTextPivot pivot, gTextAlign align);
@@ -493,12 +853,14 @@ protected:
 	void clearPixelsOnRight(uint16_t pixelsToClearOnRight);
 
 	bool pinIsChipSelect(uint8_t cs);
+	bool isInitialized(iliRotation &rotation);
+	bool waitForSleepOut();
 
 public:
 	ILI9341_due(uint8_t cs, uint8_t dc, uint8_t rst = 255);
 
 
-	bool begin(void);
+	bool begin(bool fastStart = false);
 	void getDisplayStatus();
 	void fillScreen(uint16_t color);
 	void fillRect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t color);
@@ -524,10 +886,56 @@ public:
 	void setAddrWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
 	void setAddrWindowRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
 	void setSPIClockDivider(uint8_t divider);
+	void setSPIClockDividerRead(uint8_t divider);
+	bool calibrateSPIClock(uint8_t margin = 1);
+	uint8_t getSPIClockDivider() {
+		return _spiClkDivider;
+	}
+	uint8_t getSPIClockDividerRead() {
+		return _spiClkDividerRead;
+	}
 	void setAngleOffset(int16_t angleOffset);
 	void setArcParams(float arcAngleMax);
 
+	void setTearingEffect(boolean enable, uint8_t te = 255);
+	uint16_t getScanline();
+	bool waitForVBlank();
+	bool waitForScanline(uint16_t line);
+
+#ifdef ILI_USE_STATS
+	void resetStats();
+	const iliStats& getStats(iliStatsPrimitive primitive) {
+		return _stats[primitive];
+	}
+	iliStats getTotalStats();
+	void printStats();
+	iliBusTiming getBusTiming();
+	static iliBusTiming getBusTiming(iliBusType bus, uint8_t divider, uint8_t dividerRead);
+	static uint32_t estimateMicros(const iliStats &stats, const iliBusTiming &timing);
+#endif
+
 	uint16_t readPixel(int16_t x, int16_t y);
+	void readRect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *colors);
+	void readRect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint8_t *rgb);
+
+	// lines, pixels, rectangles, circles, round rects and arcs drawn between beginDeferred and endDeferred
+	// are queued and sent when the queue fills up or on flushDeferred/endDeferred.
+	// Adjacent spans of the same color are merged into rectangles before they are sent.
+	void beginDeferred();
+	void endDeferred();
+	void flushDeferred();
+
+	// restricts drawing to the given rectangle (intersected with the current clip rectangle),
+	// anything outside of it is skipped before it is rasterized. popClipRect restores the previous one.
+	// setRotation resets the clip rectangle to the whole screen. Pushes beyond CLIP_STACK_DEPTH still narrow the
+	// clip rectangle, but popping them cannot widen it again.
+	void pushClipRect(int16_t x, int16_t y, int16_t w, int16_t h);
+	void popClipRect();
+	void resetClipRect();
+	iliClipRect getClipRect() {
+		return _clip;
+	}
+
 	void drawCircle(int16_t x, int16_t y, int16_t r, uint16_t color);
 	void fillCircle(int16_t x, int16_t y, int16_t r, uint16_t color);
 	void drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
@@ -537,12 +945,24 @@ public:
 	void drawBitmap(const uint8_t *bitmap, int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t color);
 	void drawBitmap(const uint8_t *bitmap, int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t color, uint16_t bgcolor);
 	void drawImage(const uint16_t *colors, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+	void drawSprite(const uint16_t *colors, int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t transparentColor);
+	void drawMaskedSprite(const uint16_t *colors, int16_t x, int16_t y, uint16_t w, uint16_t h, const uint8_t *mask);
+	void drawSpriteRuns(const uint16_t *colors, int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t *runs);
+	void drawImageRLE(const uint16_t *data, int16_t x, int16_t y, uint16_t w, uint16_t h);
+	void drawIndexedImage(const uint8_t *indexes, const uint16_t *palette, uint8_t bitsPerPixel, int16_t x, int16_t y, uint16_t w, uint16_t h);
+	bool drawPackImage(const uint8_t *pack, const char *name, int16_t x, int16_t y);
+	bool getPackEntry(const uint8_t *pack, const char *name, iliPackEntry &entry);
+	static uint32_t packHash(const char *name);
+	static void readPackEntry(const uint8_t *slot, iliPackEntry &entry);
 	uint8_t getRotation(void);
 	void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
 	void drawLineByAngle(int16_t x, int16_t y, int16_t angle, uint16_t length, uint16_t color);
 	void drawLineByAngle(int16_t x, int16_t y, int16_t angle, uint16_t start, uint16_t length, uint16_t color);
 
 	void screenshotToConsole();
+	// sends the screen as a binary frame (see ILI_SCREENSHOT_VERSION) to out, e.g. Serial or SerialUSB.
+	// With rowCrcs (height entries, all 0 before the first frame) only the rows that changed since the previous frame are sent.
+	void screenshot(Print &out, iliScreenshotFormat format = iliScreenshot565, uint32_t *rowCrcs = NULL);
 	
 	void setTextArea(gTextArea area);
 	void setTextArea(int16_t x, int16_t y, int16_t w, int16_t h); //, textMode mode=DEFAULT_SCROLLDIR);
@@ -551,6 +971,7 @@ public:
 	{
 		return _area;
 	}
+	void setTextScroll(bool scroll);
 
 	void clearTextArea();
 	void clearTextArea(gTextArea area);
@@ -666,6 +1087,27 @@ public:
 	void printAlignedPivotedOffseted(const String &str, gTextAlign align, gTextPivot pivot, int16_t offsetX, int16_t offsetY, uint16_t pixelsClearedOnLeft, uint16_t pixelsClearedOnRight);
 	void printAlignedPivotedOffseted(const __FlashStringHelper *str, gTextAlign align, gTextPivot pivot, int16_t offsetX, int16_t offsetY, uint16_t pixelsClearedOnLeft, uint16_t pixelsClearedOnRight);
 
+	// number formatting into buf (size bytes with the terminating 0) without String or the heap, the result is
+	// right aligned in width chars with pad in front (' ', or '0' that goes after the sign), buf is filled
+	// with '#' if it does not fit. Returns buf, e.g. printTextField(field, formatFixed(text, sizeof(text), 1234, 2)).
+	static char* formatInt(char *buf, uint8_t size, long value, uint8_t width = 0, char pad = ' ');
+	static char* formatFixed(char *buf, uint8_t size, long value, uint8_t decimals, uint8_t width = 0, char pad = ' ');	// value / 10^decimals, 1234 with 2 decimals is "12.34"
+	static char* formatFloat(char *buf, uint8_t size, double value, uint8_t decimals, uint8_t width = 0, char pad = ' ');
+
+	// a text field takes the current font, text scale and letter spacing, x and y are relative to the text area
+	void initTextField(gTextField &field, int16_t x, int16_t y, gTextPivot pivot = gTextPivotTopLeft);
+	// draws str in the field (solid, in the current text colors), only the glyphs that changed or moved
+	// and the pixels the previous text covered and str does not are drawn
+	void printTextField(gTextField &field, const char *str);
+	void clearTextField(gTextField &field);
+
+	// breaks text into lines that fit the width of the text area (at spaces, inside a word only if it does not
+	// fit on a line by itself, '\n' starts a new line) and as many of them as fit its height, with the current
+	// font, text scale, letter and line spacing. Returns the number of chars laid out, text from there on does
+	// not fit (the next page).
+	uint16_t layoutText(gTextLayout &layout, const char *text);
+	// draws the lines aligned in the text area
+	void printLayout(gTextLayout &layout, gTextAlign align = gTextAlignTopLeft);
 
 	void cursorTo(uint8_t column, uint8_t row); // 0 based coordinates for character columns and rows
 	void cursorTo(int8_t column); // move cursor on the current row
@@ -686,7 +1128,10 @@ public:
 		writecommand_cont(0xD9);  // woo sekret command?
 		writedata8_last(0x10);
 		writecommand_cont(c);
-		return readdata8_last();
+		beginRead_cont();
+		const uint8_t r = readdata8_last();
+		endRead_cont();
+		return r;
 	}
 
 	// Pass 8-bit (each) R,G,B, get back 16-bit packed color
@@ -745,12 +1190,64 @@ public:
 		return _y;
 	}
 
+	// entry of c in the glyph table of an extended font, NULL if the font has no glyph for c
+	static const uint8_t* getExtendedGlyph(uint8_t c, gTextFont font)
+	{
+		const uint8_t rangeCount = pgm_read_byte(font + GTEXT_XFONT_RANGE_COUNT);
+		const uint8_t *range = font + GTEXT_XFONT_RANGES;
+		for (uint8_t r = 0; r < rangeCount; r++, range += GTEXT_XFONT_RANGE_SIZE)
+		{
+			const uint8_t first = pgm_read_byte(range);
+			if (c >= first && c - first < pgm_read_byte(range + 1))
+			{
+				const uint16_t glyph = pgm_read_byte(range + 2) + (pgm_read_byte(range + 3) << 8) + (c - first);
+				return font + GTEXT_XFONT_RANGES + rangeCount * GTEXT_XFONT_RANGE_SIZE + glyph * GTEXT_XFONT_GLYPH_SIZE;
+			}
+		}
+		return NULL;
+	}
+
+	// start of the data of a glyph of an extended font, glyph is the entry returned by getExtendedGlyph
+	static const uint8_t* getExtendedGlyphData(const uint8_t *glyph, gTextFont font)
+	{
+		const uint8_t rangeCount = pgm_read_byte(font + GTEXT_XFONT_RANGE_COUNT);
+		const uint16_t glyphCount = pgm_read_byte(font + GTEXT_XFONT_GLYPH_COUNT) | (pgm_read_byte(font + GTEXT_XFONT_GLYPH_COUNT + 1) << 8);
+		const uint32_t offset = pgm_read_byte(glyph + 1) | ((uint32_t)pgm_read_byte(glyph + 2) << 8) | ((uint32_t)pgm_read_byte(glyph + 3) << 16);
+		return font + GTEXT_XFONT_RANGES + rangeCount * GTEXT_XFONT_RANGE_SIZE + glyphCount * GTEXT_XFONT_GLYPH_SIZE + offset;
+	}
+
+	// width of a column in cursorTo and setTextArea with columns
+	static uint8_t getFontColumnWidth(gTextFont font)
+	{
+		if (isExtendedFont(font))
+			return pgm_read_byte(font + GTEXT_XFONT_COLUMN_WIDTH);
+		return pgm_read_byte(font + GTEXT_FONT_FIXED_WIDTH);
+	}
+
+	// false for chars write does not draw (and does not put letter spacing in front of), glyphs can be 0 pixels wide
+	static bool isCharInFont(uint8_t c, gTextFont font)
+	{
+		if (c < 0x20)
+			return false;
+		if (isExtendedFont(font))
+			return getExtendedGlyph(c, font) != NULL;
+		const uint8_t firstChar = pgm_read_byte(font + GTEXT_FONT_FIRST_CHAR);
+		return c >= firstChar && c - firstChar < pgm_read_byte(font + GTEXT_FONT_CHAR_COUNT);
+	}
+
 	static uint16_t getCharWidth(uint8_t c, gTextFont font, uint8_t textScale)
 	{
 		int16_t width = 0;
 
-		if (isFixedWidthFont(font){
-			width = (pgm_read_byte(font + GTEXT_FONT_FIXED_WIDTH)) * textScale;
+		if (isExtendedFont(font)) {
+			const uint8_t *glyph = getExtendedGlyph(c, font);
+			if (glyph)
+				width = pgm_read_byte(glyph) * textScale;
+		}
+		else if (isFixedWidthFont(font){
+			// chars the font does not have are not drawn (see write)
+			if (c >= pgm_read_byte(font + GTEXT_FONT_FIRST_CHAR) && c - pgm_read_byte(font + GTEXT_FONT_FIRST_CHAR) < pgm_read_byte(font + GTEXT_FONT_CHAR_COUNT))
+				width = (pgm_read_byte(font + GTEXT_FONT_FIXED_WIDTH)) * textScale;
 		}
 		else{
 			// variable width font 
@@ -782,6 +1279,7 @@ public:
 	inline __attribute__((always_inline))
 		void fillArc(uint16_t x, uint16_t y, uint16_t radius, uint16_t thickness, float start, float end, uint16_t color)
 	{
+		if (!isRectVisible(x - radius, y - radius, 2 * radius + 1, 2 * radius + 1)) return;
 		beginTransaction();
 		if (start == 0 && end == _arcAngleMax)
 			fillArcOffsetted(x, y, radius, thickness, 0, _arcAngleMax, color);
@@ -819,6 +1317,45 @@ public:
 		return sin(angle * DEG_TO_RAD);
 	}
 
+protected:
+
+	// returns true if any part of the rectangle is inside the clip rectangle
+	__attribute__((always_inline))
+		bool isRectVisible(int16_t x, int16_t y, int16_t w, int16_t h) {
+		return x < _clip.x2 && y < _clip.y2 && x + w > _clip.x1 && y + h > _clip.y1;
+	}
+
+	__attribute__((always_inline))
+		bool isPixelVisible(int16_t x, int16_t y) {
+		return x >= _clip.x1 && x < _clip.x2 && y >= _clip.y1 && y < _clip.y2;
+	}
+
+	// trims the rectangle to the clip rectangle, returns false if nothing is left
+	__attribute__((always_inline))
+		bool clipRect(int16_t &x, int16_t &y, int16_t &w, int16_t &h) {
+		if (x < _clip.x1) { w -= _clip.x1 - x; x = _clip.x1; }
+		if (y < _clip.y1) { h -= _clip.y1 - y; y = _clip.y1; }
+		if (x + w > _clip.x2) w = _clip.x2 - x;
+		if (y + h > _clip.y2) h = _clip.y2 - y;
+		return w > 0 && h > 0;
+	}
+
+	__attribute__((always_inline))
+		bool clipHLine(int16_t &x, int16_t y, int16_t &w) {
+		if (y < _clip.y1 || y >= _clip.y2) return false;
+		if (x < _clip.x1) { w -= _clip.x1 - x; x = _clip.x1; }
+		if (x + w > _clip.x2) w = _clip.x2 - x;
+		return w > 0;
+	}
+
+	__attribute__((always_inline))
+		bool clipVLine(int16_t x, int16_t &y, int16_t &h) {
+		if (x < _clip.x1 || x >= _clip.x2) return false;
+		if (y < _clip.y1) { h -= _clip.y1 - y; y = _clip.y1; }
+		if (y + h > _clip.y2) h = _clip.y2 - y;
+		return h > 0;
+	}
+
 protected:
 
 	__attribute__((always_inline))
@@ -845,6 +1382,32 @@ protected:
 #endif
 	}
 
+	// changes SCK of the running transaction, the stored dividers are left as they are
+	__attribute__((always_inline))
+		void setSPIClock_cont(uint8_t divider) {
+#if SPI_MODE_NORMAL
+		SPI.setClockDivider(divider);
+#elif SPI_MODE_EXTENDED
+		SPI.setClockDivider(_cs, divider);
+#elif SPI_MODE_DMA
+		SPI0->SPI_CSR[ILI_SPI_CHIP_SEL] = (SPI0->SPI_CSR[ILI_SPI_CHIP_SEL] & ~SPI_CSR_SCBR_Msk) | SPI_CSR_SCBR(divider);
+#endif
+	}
+
+	// slows SCK down for reading, call after the read command has been sent
+	__attribute__((always_inline))
+		void beginRead_cont() {
+		if (_spiClkDividerRead != _spiClkDivider)
+			setSPIClock_cont(_spiClkDividerRead);
+	}
+
+	// brings SCK back to the write speed
+	__attribute__((always_inline))
+		void endRead_cont() {
+		if (_spiClkDividerRead != _spiClkDivider)
+			setSPIClock_cont(_spiClkDivider);
+	}
+
 	__attribute__((always_inline))
 		void endTransaction() {
 #ifdef ILI_USE_SPI_TRANSACTION
@@ -888,6 +1451,7 @@ protected:
 	// CS and DC have to be set prior to calling this method
 	__attribute__((always_inline))
 		void write8_cont(uint8_t c){
+		ILI_STATS_WRITE8(c);
 #if SPI_MODE_NORMAL
 		spiwrite(c);
 #elif SPI_MODE_EXTENDED
@@ -901,6 +1465,7 @@ protected:
 	// CS and DC have to be set prior to calling this method
 	inline __attribute__((always_inline))
 		void write8_last(uint8_t c) {
+		ILI_STATS_WRITE8(c);
 #if SPI_MODE_NORMAL
 		spiwrite(c);
 		disableCS();
@@ -916,6 +1481,7 @@ protected:
 	// CS, DC have to be set prior to calling this method
 	__attribute__((always_inline))
 		void write16_cont(uint16_t d) {
+		ILI_STATS_WRITE(2);
 #if SPI_MODE_NORMAL
 		spiwrite16(d);
 #elif SPI_MODE_EXTENDED
@@ -929,6 +1495,7 @@ protected:
 
 	__attribute__((always_inline))
 		void write16_last(uint16_t d) {
+		ILI_STATS_WRITE(2);
 #if SPI_MODE_NORMAL
 		spiwrite16(d);
 		disableCS();
@@ -1186,6 +1753,7 @@ protected:
 
 	inline __attribute__((always_inline))
 		void write_cont(uint16_t* buf, uint32_t n) {
+		ILI_STATS_BLOCK(n << 1);
 #if SPI_MODE_NORMAL
 		spiTransfer(buf, n);
 #elif SPI_MODE_EXTENDED
@@ -1197,6 +1765,7 @@ protected:
 
 	inline __attribute__((always_inline))
 		void write_cont(const uint16_t* buf, uint32_t n) {
+		ILI_STATS_BLOCK(n << 1);
 #if SPI_MODE_NORMAL
 		spiTransfer(buf, n);
 #elif SPI_MODE_EXTENDED
@@ -1209,7 +1778,17 @@ protected:
 	inline __attribute__((always_inline))
 		void read_cont(uint8_t* buf, uint32_t n) {
 #if SPI_MODE_DMA
-		dmaReceive(buf, n);
+		ILI_STATS_READ(n);
+		// one DMA transfer can move at most 65535 bytes
+		while (n > 0) {
+			const uint16_t chunk = min(n, 0xFFFF);
+			dmaReceive(buf, chunk);
+			buf += chunk;
+			n -= chunk;
+		}
+#else
+		for (uint32_t i = 0; i < n; i++)
+			buf[i] = read8_cont();
 #endif
 	}
 
@@ -1266,6 +1845,7 @@ protected:
 		void writeScanline16(uint32_t n) {
 		/*setDCForData();
 		enableCS();*/
+		ILI_STATS_BLOCK(n << 1);
 #if SPI_MODE_NORMAL
 		spiTransfer(_scanline16, n);
 #elif SPI_MODE_EXTENDED
@@ -1318,6 +1898,7 @@ protected:
 	// Reads 1 byte
 	__attribute__((always_inline))
 		uint8_t read8_cont()  {
+		ILI_STATS_READ(1);
 #if SPI_MODE_NORMAL
 		return SPI.transfer(ILI9341_NOP);
 #elif SPI_MODE_EXTENDED
@@ -1329,6 +1910,7 @@ protected:
 
 	__attribute__((always_inline))
 		uint8_t read8_last() {
+		ILI_STATS_READ(1);
 #if SPI_MODE_NORMAL
 		uint8_t r = SPI.transfer(ILI9341_NOP);
 		disableCS();
@@ -1345,6 +1927,7 @@ protected:
 	// Reads 2 bytes
 	__attribute__((always_inline))
 		uint16_t read16()  {
+		ILI_STATS_READ(2);
 #if SPI_MODE_NORMAL
 		uint16_t r = SPI.transfer(ILI9341_NOP);
 		r <<= 8;
@@ -1364,6 +1947,7 @@ protected:
 	// Reads 2 bytes
 	__attribute__((always_inline))
 		uint16_t readPixel_start_cont() {
+		ILI_STATS_READ(2);
 #if SPI_MODE_NORMAL
 		uint16_t r = SPI.transfer(ILI9341_NOP);
 		r <<= 8;
@@ -1458,7 +2042,7 @@ protected:
 
 	__attribute__((always_inline))
 		void fillScanline16(uint16_t color) {
-
+		_color = color;
 		for (uint16_t i = 0; i < SCANLINE_PIXEL_COUNT; i++)
 		{
 			_scanline16[i] = color;
@@ -1467,7 +2051,7 @@ protected:
 
 	__attribute__((always_inline))
 		void fillScanline16(uint16_t color, uint16_t len) {
-
+		_color = color;
 		for (uint16_t i = 0; i < len; i++)
 		{
 			_scanline16[i] = color;
@@ -1566,6 +2150,13 @@ protected:
 	__attribute__((always_inline))
 		void writeHLine_cont_noCS_noFill(int16_t x, int16_t y, int16_t w)
 	{
+		if (!clipHLine(x, y, w)) return;
+#ifdef ILI_USE_DEFERRED_SPANS
+		if (_isDeferred) {
+			queueSpan(x, y, w, 1, _color);
+			return;
+		}
+#endif
 #ifdef ARDUINO_ARCH_AVR
 		const uint32_t numLoops = (uint32_t)w / (uint32_t)SCANLINE_PIXEL_COUNT;
 		setAddrAndRW_cont(x, y, w, 1);
@@ -1587,6 +2178,13 @@ protected:
 	__attribute__((always_inline))
 		void writeHLine_cont_noCS_noScanline(int16_t x, int16_t y, int16_t w, uint16_t color)
 	{
+		if (!clipHLine(x, y, w)) return;
+#ifdef ILI_USE_DEFERRED_SPANS
+		if (_isDeferred) {
+			queueSpan(x, y, w, 1, color);
+			return;
+		}
+#endif
 		setAddrAndRW_cont(x, y, w, 1);
 		setDCForData();
 		while (w-- > 0) {
@@ -1602,6 +2200,13 @@ protected:
 	__attribute__((always_inline))
 		void writeVLine_cont_noCS_noFill(int16_t x, int16_t y, int16_t h)
 	{
+		if (!clipVLine(x, y, h)) return;
+#ifdef ILI_USE_DEFERRED_SPANS
+		if (_isDeferred) {
+			queueSpan(x, y, 1, h, _color);
+			return;
+		}
+#endif
 #ifdef ARDUINO_ARCH_AVR
 		const uint32_t numLoops = (uint32_t)h / (uint32_t)SCANLINE_PIXEL_COUNT;
 		setAddrAndRW_cont(x, y, 1, h);
@@ -1623,6 +2228,13 @@ protected:
 	__attribute__((always_inline))
 		void writeVLine_cont_noCS_noScanline(int16_t x, int16_t y, int16_t h, uint16_t color)
 	{
+		if (!clipVLine(x, y, h)) return;
+#ifdef ILI_USE_DEFERRED_SPANS
+		if (_isDeferred) {
+			queueSpan(x, y, 1, h, color);
+			return;
+		}
+#endif
 		setAddrAndRW_cont(x, y, 1, h);
 		setDCForData();
 		while (h-- > 0) {
@@ -1633,6 +2245,12 @@ protected:
 	inline __attribute__((always_inline))
 		void writePixel_cont(int16_t x, int16_t y, uint16_t color)
 	{
+#ifdef ILI_USE_DEFERRED_SPANS
+		if (_isDeferred) {
+			queueSpan(x, y, 1, 1, color);
+			return;
+		}
+#endif
 		setAddrAndRW_cont_inline(x, y, 1, 1);
 		setDCForData();
 		write16_cont(color);
@@ -1642,6 +2260,13 @@ protected:
 	inline __attribute__((always_inline))
 		void writePixel_last(int16_t x, int16_t y, uint16_t color)
 	{
+#ifdef ILI_USE_DEFERRED_SPANS
+		if (_isDeferred) {
+			queueSpan(x, y, 1, 1, color);
+			disableCS();
+			return;
+		}
+#endif
 		setAddrAndRW_cont(x, y, 1, 1);
 		setDCForData();
 		write16_last(color);
@@ -1652,14 +2277,14 @@ protected:
 #endif
 		void drawPixel_cont(int16_t x, int16_t y, uint16_t color) {
 
-		if ((x < 0) || (x >= _width) || (y < 0) || (y >= _height)) return;
+		if (!isPixelVisible(x, y)) return;
 		writePixel_cont(x, y, color);
 	}
 
 	inline __attribute__((always_inline))
 		void drawPixel_last(int16_t x, int16_t y, uint16_t color) {
 
-		if ((x < 0) || (x >= _width) || (y < 0) || (y >= _height)) return;
+		if (!isPixelVisible(x, y)) return;
 		writePixel_last(x, y, color);
 	}
 
@@ -1667,6 +2292,7 @@ protected:
 	inline __attribute__((always_inline))
 		void enableCS(){
 #if SPI_MODE_NORMAL | SPI_MODE_DMA
+		ILI_STATS_CS_LOW();
 		*_csport &= ~_cspinmask;
 #endif
 	}
@@ -1675,6 +2301,7 @@ protected:
 	inline __attribute__((always_inline))
 		void disableCS() {
 #if SPI_MODE_NORMAL | SPI_MODE_DMA
+		ILI_STATS_CS_HIGH();
 		*_csport |= _cspinmask;
 		//csport->PIO_SODR  |=  cspinmask;
 #elif SPI_MODE_EXTENDED
@@ -1685,6 +2312,7 @@ protected:
 	// Sets DC to Data (1)
 	inline __attribute__((always_inline))
 		void setDCForData() {
+		ILI_STATS_DC(false);
 		*_dcport |= _dcpinmask;
 		//_dcport->PIO_SODR |= _dcpinmask;
 	}
@@ -1692,6 +2320,7 @@ protected:
 	// Sets DC to Command (0)	
 	inline __attribute__((always_inline))
 		void setDCForCommand(){
+		ILI_STATS_DC(true);
 		*_dcport &= ~_dcpinmask;
 	}
 #ifdef ARDUINO_ARCH_AVR
@@ -1993,22 +2622,6 @@ protected:
 		SPI0->SPI_CSR[ch] &= 0xFFFFFF0F; //restore 8bit
 	}
 #elif SPI_MODE_DMA
-	/** Use SAM3X DMAC if nonzero */
-#define ILI_USE_SAM3X_DMAC 1
-	/** Use extra Bus Matrix arbitration fix if nonzero */
-#define ILI_USE_SAM3X_BUS_MATRIX_FIX 0
-	/** Time in ms for DMA receive timeout */
-#define ILI_SAM3X_DMA_TIMEOUT 100
-	/** chip select register number */
-#define ILI_SPI_CHIP_SEL 3
-	/** DMAC receive channel */
-#define ILI_SPI_DMAC_RX_CH  1
-	/** DMAC transmit channel */
-#define ILI_SPI_DMAC_TX_CH  0
-	/** DMAC Channel HW Interface Number for SPI TX. */
-#define ILI_SPI_TX_IDX  1
-	/** DMAC Channel HW Interface Number for SPI RX. */
-#define ILI_SPI_RX_IDX  2
 	//------------------------------------------------------------------------------
 	/** Disable DMA Controller. */
 	static void dmac_disable() {
@@ -2202,9 +2815,11 @@ protected:
 		// clear overrun error
 		pSpi->SPI_SR;
 
+		ILI_STATS_DMA();
 		spiDmaRX(buf, n);
 		spiDmaTX(0, n);
 
+		ILI_STATS_WAIT_BEGIN();
 		uint32_t m = millis();
 		while (!dmac_channel_transfer_done(ILI_SPI_DMAC_RX_CH)) {
 			if ((millis() - m) > ILI_SAM3X_DMA_TIMEOUT)  {
@@ -2214,6 +2829,7 @@ protected:
 				break;
 			}
 		}
+		ILI_STATS_WAIT_END();
 		if (pSpi->SPI_SR & SPI_SR_OVRES) rtn |= 1;
 #else  // ILI_USE_SAM3X_DMAC
 		for (uint32_t i = 0; i < n; i++) {
@@ -2238,9 +2854,12 @@ protected:
 	//------------------------------------------------------------------------------
 	void dmaSend(const uint8_t* buf, uint32_t n) {
 		Spi* pSpi = SPI0;
+		ILI_STATS_DMA();
 		spiDmaTX(buf, n);
+		ILI_STATS_WAIT_BEGIN();
 		while (!dmac_channel_transfer_done(ILI_SPI_DMAC_TX_CH)) {}
 		while ((pSpi->SPI_SR & SPI_SR_TXEMPTY) == 0) {}
+		ILI_STATS_WAIT_END();
 		// leave RDR empty
 		pSpi->SPI_RDR;
 	}
@@ -2248,9 +2867,12 @@ protected:
 	void dmaSend(const uint16_t* buf, uint32_t n) {
 		Spi* pSpi = SPI0;
 		pSpi->SPI_CSR[ILI_SPI_CHIP_SEL] = SPI_CSR_SCBR(_spiClkDivider) | SPI_CSR_NCPHA | SPI_CSR_BITS_16_BIT;
+		ILI_STATS_DMA();
 		spiDmaTX16(buf, n);
+		ILI_STATS_WAIT_BEGIN();
 		while (!dmac_channel_transfer_done(ILI_SPI_DMAC_TX_CH)) {}
 		while ((pSpi->SPI_SR & SPI_SR_TXEMPTY) == 0) {}
+		ILI_STATS_WAIT_END();
 		// leave RDR empty
 		pSpi->SPI_RDR;
 		pSpi->SPI_CSR[ILI_SPI_CHIP_SEL] = SPI_CSR_SCBR(_spiClkDivider) | SPI_CSR_NCPHA | SPI_CSR_BITS_8_BIT;
@@ -23,9 +23,64 @@ Copyright (c) 2015  Marek Buriak
 #define ILI9341_SPI_CLKDIVIDER SPI_CLOCK_DIV2	// for Uno, Mega,...
 #endif
 
+// set the clock divider used while reading from the display (readPixel, readRect, screenshotToConsole,...)
+// ILI9341 sends data reliably only at a lower clock than it receives them, writing stays at ILI9341_SPI_CLKDIVIDER
+#if defined ARDUINO_SAM_DUE
+#define ILI9341_SPI_CLKDIVIDER_READ 16	// for Due
+#elif defined ARDUINO_ARCH_AVR
+#define ILI9341_SPI_CLKDIVIDER_READ SPI_CLOCK_DIV4	// for Uno, Mega,...
+#endif
+
 // uncomment if you want to use SPI transactions. Uncomment it if the library does not work when used with other libraries.
 //#define ILI_USE_SPI_TRANSACTION
 
+// uncomment to use deferred drawing (beginDeferred/endDeferred), otherwise they do nothing and everything is drawn
+// right away. Each span in the queue takes 10 bytes of RAM.
+//#define ILI_USE_DEFERRED_SPANS
+
+// number of spans (lines, pixels, rectangles) the deferred queue can hold before it is flushed
+#if defined ARDUINO_SAM_DUE
+#define DEFERRED_SPAN_QUEUE_SIZE 128
+#elif defined ARDUINO_ARCH_AVR
+#define DEFERRED_SPAN_QUEUE_SIZE 16
+#endif
+
+// uncomment to count the bytes, commands, address windows, CS toggles and DMA transfers each kind of drawing
+// functions causes (getStats, printStats) and to estimate the time they take on the bus (estimateMicros).
+// Costs a few cycles per byte sent and about 600 bytes of RAM.
+//#define ILI_USE_STATS
+
+// uncomment to keep the glyphs drawn last decoded in RAM as runs of pixels (least recently used ones are replaced).
+// A char drawn again, like the digits of a readout, is then drawn from the runs without reading the font.
+// Each slot takes ILI_GLYPH_CACHE_SLOT_SIZE + about 10 bytes of RAM, glyphs that need more are drawn from the font.
+//#define ILI_USE_GLYPH_CACHE
+
+// number of glyphs the glyph cache holds and the bytes of runs each of them can take
+#if defined ARDUINO_SAM_DUE
+#define ILI_GLYPH_CACHE_SLOTS 12
+#define ILI_GLYPH_CACHE_SLOT_SIZE 192
+#elif defined ARDUINO_ARCH_AVR
+#define ILI_GLYPH_CACHE_SLOTS 4
+#define ILI_GLYPH_CACHE_SLOT_SIZE 48
+#endif
+
+// how many clip rectangles can be pushed with pushClipRect
+#define CLIP_STACK_DEPTH 4
+
+// the most chars a text field (printTextField) holds, the ones after them are not printed
+#if defined ARDUINO_SAM_DUE
+#define GTEXT_FIELD_MAX_CHARS 16
+#elif defined ARDUINO_ARCH_AVR
+#define GTEXT_FIELD_MAX_CHARS 10
+#endif
+
+// the most lines a text layout (layoutText) holds
+#if defined ARDUINO_SAM_DUE
+#define GTEXT_LAYOUT_MAX_LINES 24
+#elif defined ARDUINO_ARCH_AVR
+#define GTEXT_LAYOUT_MAX_LINES 8
+#endif
+
 // comment out if you do need to use scaled text. The text will draw then faster.
 #define TEXT_SCALING_ENABLED
 
@@ -0,0 +1,60 @@
+/*
+This sketch is demonstrating text fields, printTextField redraws only the digits
+that changed since the last time the field was printed, and clears only the pixels
+the previous value covered and the new one does not.
+A page of readouts updating many times per second sends a fraction of the data
+it would with printAt and cleared margins.
+*/
+
+#include "SPI.h"
+#include "ILI9341_due_config.h"
+#include "ILI9341_due.h"
+
+#include "fonts\Arial_bold_14.h"
+#include "fonts\fixednums8x16.h"
+
+// CS and DC for the LCD
+#define LCD_CS 10	// Chip Select for LCD
+#define LCD_DC 9	// Command/Data for LCD
+#define LCD_RST 8	// Command/Data for LCD
+
+ILI9341_due tft(LCD_CS, LCD_DC, LCD_RST);
+
+#define FIELD_COUNT 8
+gTextField fields[FIELD_COUNT];
+uint32_t counter = 0;
+
+void setup()
+{
+	tft.begin();
+	tft.setRotation(iliRotation270);	// landscape
+	tft.fillScreen(ILI9341_BLACK);
+
+	tft.setTextColor(ILI9341_WHITE, ILI9341_BLACK);
+	tft.setFont(Arial_bold_14);
+	for (uint8_t i = 0; i < FIELD_COUNT; i++)
+	{
+		char label[16];
+		sprintf(label, "Sensor %u", i + 1);
+		tft.printAt(label, 20, 20 + i * 26);
+	}
+
+	// values aligned to the right at x = 300
+	tft.setFont(fixednums8x16);
+	tft.setTextScale(1);
+	for (uint8_t i = 0; i < FIELD_COUNT; i++)
+		tft.initTextField(fields[i], 300, 20 + i * 26, gTextPivotTopRight);
+}
+
+void loop()
+{
+	char text[16];
+	for (uint8_t i = 0; i < FIELD_COUNT; i++)
+	{
+		const long value = (long)(counter * (i + 1) * 7 % 20000) - 10000;	// in tenths
+		// formats "-12.3" into text, no String and no heap
+		tft.printTextField(fields[i], ILI9341_due::formatFixed(text, sizeof(text), value, 1));
+	}
+	counter++;
+	delay(100);
+}
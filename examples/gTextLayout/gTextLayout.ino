@@ -0,0 +1,59 @@
+/*
+This sketch is demonstrating layoutText and printLayout, a help text is broken into
+lines that fit the text area once, printLayout draws them centered without measuring
+the text again. layoutText returns where the text that did not fit starts, the sketch
+shows the help page by page.
+*/
+
+#include "SPI.h"
+#include "ILI9341_due_config.h"
+#include "ILI9341_due.h"
+
+#include "fonts\Arial14.h"
+
+// CS and DC for the LCD
+#define LCD_CS 10	// Chip Select for LCD
+#define LCD_DC 9	// Command/Data for LCD
+#define LCD_RST 8	// Command/Data for LCD
+
+ILI9341_due tft(LCD_CS, LCD_DC, LCD_RST);
+
+const char help[] =
+	"Press the left button to start the measurement. The readout updates ten times a second.\n"
+	"\n"
+	"Hold the right button for three seconds to reset the counters. The counters are kept when "
+	"the power is switched off, they are saved every minute.\n"
+	"\n"
+	"The backlight dims after two minutes without a button press, any button turns it back on "
+	"without doing anything else.\n"
+	"\n"
+	"Connect a PC to the USB port to download the log, the measurement keeps running while it is "
+	"being downloaded.";
+
+gTextLayout layout;
+uint16_t pageStart = 0;
+
+void setup()
+{
+	tft.begin();
+	tft.setRotation(iliRotation270);	// landscape
+	tft.fillScreen(ILI9341_BLACK);
+
+	tft.setFont(Arial14);
+	tft.setTextColor(ILI9341_WHITE, ILI9341_BLACK);
+	tft.setTextLetterSpacing(1);
+	tft.setTextLineSpacing(4);
+	tft.setTextArea(20, 20, 280, 200);
+}
+
+void loop()
+{
+	tft.clearTextArea();
+	const uint16_t laidOut = tft.layoutText(layout, help + pageStart);
+	tft.printLayout(layout, gTextAlignMiddleCenter);
+
+	pageStart += laidOut;
+	if (laidOut == 0 || help[pageStart] == '\0')
+		pageStart = 0;	// back to the first page
+	delay(3000);
+}
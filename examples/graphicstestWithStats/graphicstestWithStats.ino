@@ -80,6 +80,9 @@ void setup() {
 
 	Serial.println(F("Benchmark                Time (microseconds)"));
 
+#ifdef ILI_USE_STATS
+	tft.resetStats();
+#endif
 	Serial.print(F("Screen fill              "));
 	unsigned long start = micros();
 	Serial.println(Screenfill = testFillScreen());
@@ -131,6 +134,11 @@ void setup() {
 
 	Serial.println(F("Done!"));
 
+#ifdef ILI_USE_STATS
+	// what the time above was spent on (enable ILI_USE_STATS in ILI9341_due_config.h)
+	tft.printStats();
+#endif
+
 	tft.fillScreen(ILI9341_BLUE);
 	tft.setRotation(iliRotation270);
 	tft.setFont(Arial_bold_14);
@@ -0,0 +1,58 @@
+/*
+This sketch is demonstrating taking screenshots with screenshot() and ILIScreenshot
+from the Tools folder.
+Instructions:
+- Compile and upload the sketch.
+- Run ILIScreenshot with the port your Arduino is connected to and the baud rate
+  of 115200 (has to be the same as in Serial.begin(115200);), e.g.
+    ILIScreenshot -c /dev/ttyACM0 shot.png
+  or
+    ILIScreenshot -c COM3 shot.png
+- restart Arduino (if it has not automatically)
+- a new image (shot0001.png, shot0002.png,...) gets saved every second
+
+Only the rows that changed since the previous screenshot are sent, so each
+screenshot after the first one takes only a few hundred bytes here.
+On Due, SerialUSB (the Native USB port) is much faster than Serial.
+*/
+
+#include "SPI.h"
+#include "ILI9341_due_config.h"
+#include "ILI9341_due.h"
+
+#include "fonts\Arial_bold_14.h"
+
+// CS and DC for the LCD
+#define LCD_CS 10	// Chip Select for LCD
+#define LCD_DC 9	// Command/Data for LCD
+#define LCD_RST 8	// Command/Data for LCD
+
+ILI9341_due tft(LCD_CS, LCD_DC, LCD_RST);
+
+uint32_t rowCrcs[240];	// one for each row of the screen (its height in the current rotation)
+uint16_t counter = 0;
+
+void setup()
+{
+	Serial.begin(115200);
+	tft.begin();
+	tft.setRotation(iliRotation270);	// landscape
+
+	tft.fillScreen(ILI9341_NAVY);
+	tft.fillRoundRect(60, 40, 200, 160, 10, ILI9341_WHITE);
+	tft.setFont(Arial_bold_14);
+	tft.setTextColor(ILI9341_BLACK, ILI9341_WHITE);
+
+	memset(rowCrcs, 0, sizeof(rowCrcs));	// the first screenshot sends all rows
+}
+
+void loop()
+{
+	char text[16];
+	sprintf(text, "Frame: %u", counter++);
+	tft.printAt(text, 100, 110, 0, 20);	// clears 20 pixels right of the text, the number can get shorter
+
+	// reduce the SPI clock speed used for reading if you get errors or image artifacts
+	tft.screenshot(Serial, iliScreenshot565, rowCrcs);
+	delay(1000);
+}
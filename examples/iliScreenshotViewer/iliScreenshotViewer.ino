@@ -31,11 +31,11 @@ void setup()
 	tft.fillScreen(ILI9341_BLACK);
 	tft.drawImage(alert, 140, 100, alertWidth, alertHeight);
 
-	// reduce the SPI clock speed if you get errors or image artifacts
+	// reduce the SPI clock speed used for reading if you get errors or image artifacts
 //#ifdef __ARM__
-//	tft.setSPIClockDivider(10);
+//	tft.setSPIClockDividerRead(21);
 //#elif defined __AVR__
-//	tft.setSPIClockDivider(SPI_CLOCK_DIV8);
+//	tft.setSPIClockDividerRead(SPI_CLOCK_DIV8);
 //#endif
 	tft.screenshotToConsole();
 }
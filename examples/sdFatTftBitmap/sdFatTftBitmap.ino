@@ -13,6 +13,11 @@ Obviously you have to modify CS, DC pins for TFT and SD appropriately.
 You can generate your own .565 images from 24bit BMPs by using BMP24toILI565 converter which
 you can find in the Tools folder on GitHub:
 https://github.com/marekburiak/ILI9341_due/tree/master/tools
+
+Even faster is to put all images into one image pack with ILIPack (also in the Tools folder):
+  ILIPack -a 512 -f raw images.ilp giraffe.bmp soldHouse.bmp gloomyTears.bmp motivation.bmp ...
+copy images.ilp onto the SD card and uncomment USE_IMAGE_PACK. The pack is opened once,
+each image is then found with one read of the pack's index and loaded with one seek.
 */
 
 #include <SPI.h>
@@ -30,8 +35,12 @@ https://github.com/marekburiak/ILI9341_due/tree/master/tools
 #define BUFFPIXELCOUNT 160	// size of the buffer in pixels
 #define SD_SPI_SPEED SPI_HALF_SPEED	// SD card SPI speed, try SPI_FULL_SPEED
 
+//#define USE_IMAGE_PACK	// load the images from images.ilp instead of the .565 files
+
 SdFat sd; // set filesystem
 SdFile bmpFile; // set filesystem
+SdFile packFile;	// images.ilp, stays open
+uint16_t packSlotCount = 0;	// slots in the pack's index, read from its header once
 //ArduinoOutStream cout(Serial);
 
 //ILI9341_due tft = ILI9341_due(TFT_CS, TFT_DC);		//ILI9341
@@ -54,10 +63,42 @@ void setup()
 		return;
 	}
 	progmemPrintln(PSTR("OK!"));
+
+#ifdef USE_IMAGE_PACK
+	uint8_t header[ILI_PACK_HEADER_SIZE];
+	if (!packFile.open("images.ilp", O_READ))
+		progmemPrintln(PSTR("images.ilp not found."));
+	else if (packFile.read(header, ILI_PACK_HEADER_SIZE) != ILI_PACK_HEADER_SIZE || memcmp(header, "ILPK", 4) != 0)
+		progmemPrintln(PSTR("images.ilp is not an image pack."));
+	else
+		packSlotCount = header[6] | (header[7] << 8);
+#endif
 }
 
 void loop()
 {
+#ifdef USE_IMAGE_PACK
+	tft.setRotation(iliRotation270);
+	packDraw("giraffe", 0, 0);
+	delay(2000);
+	packDraw("soldHouse", 0, 0);
+	delay(2000);
+	packDraw("gloomyTears", 0, 0);
+	delay(2000);
+	packDraw("motivation", 0, 0);
+	delay(2000);
+	tft.setRotation(iliRotation180);
+	packDraw("smokeP", 0, 0);
+	delay(2000);
+	packDraw("origP", 0, 0);
+	delay(2000);
+	packDraw("radioP", 0, 0);
+	delay(2000);
+	packDraw("stopP", 0, 0);
+	delay(2000);
+	return;
+#endif
+
 	tft.setRotation(iliRotation270);
 	bmpDraw("giraffe.565", 0, 0);
 	delay(2000);
@@ -260,6 +301,68 @@ void bmpDraw(char* filename, int x, int y) {
 }
 
 
+// Draws an image from the image pack opened in setup. The slot of the image is read from the pack's index
+// (the next slots only if another image has the same slot), the pixels are then read
+// in one sequence right behind one seek. Images packed as raw (ILIPack -f raw) can be loaded this way.
+void packDraw(const char* name, int x, int y) {
+	uint8_t slot[ILI_PACK_SLOT_SIZE];
+	iliPackEntry entry;
+	uint32_t startTime = millis();
+
+	progmemPrint(PSTR("Loading image '"));
+	Serial.print(name);
+	Serial.println('\'');
+
+	if (packSlotCount == 0) {
+		progmemPrintln(PSTR("No image pack."));
+		return;
+	}
+	const uint16_t slotCount = packSlotCount;
+	const uint32_t hash = tft.packHash(name);
+
+	uint16_t s = hash & (slotCount - 1);
+	for (uint16_t probe = 0; ; probe++) {
+		if (probe == slotCount) {
+			progmemPrintln(PSTR("Image not found."));
+			return;
+		}
+		packFile.seekSet(ILI_PACK_HEADER_SIZE + (uint32_t)s * ILI_PACK_SLOT_SIZE);
+		packFile.read(slot, ILI_PACK_SLOT_SIZE);
+		tft.readPackEntry(slot, entry);
+		if (entry.format == iliPackEmpty) {
+			progmemPrintln(PSTR("Image not found."));
+			return;
+		}
+		if (entry.hash == hash)
+			break;
+		s = (s + 1) & (slotCount - 1);
+	}
+
+	if (entry.format != iliPackRaw) {
+		progmemPrintln(PSTR("Only raw images can be loaded from SD, pack them with -f raw."));
+		return;
+	}
+	if ((x + entry.w - 1) >= tft.width() || (y + entry.h - 1) >= tft.height()) {
+		progmemPrintln(PSTR("Image does not fit on the screen."));
+		return;
+	}
+
+	uint16_t buffer[BUFFPIXELCOUNT]; // pixel buffer
+	tft.setAddrWindow(x, y, x + entry.w - 1, y + entry.h - 1);
+	packFile.seekSet(entry.offset);
+	uint32_t remainingPixels = (uint32_t)entry.w * entry.h;
+	while (remainingPixels > 0) {
+		const uint16_t n = min(remainingPixels, BUFFPIXELCOUNT);
+		packFile.read(buffer, 2 * n);
+		tft.pushColors(buffer, 0, n);
+		remainingPixels -= n;
+	}
+
+	progmemPrint(PSTR("Loaded in "));
+	Serial.print(millis() - startTime);
+	Serial.println(" ms");
+}
+
 // These read 16- and 32-bit types from the SD card file.
 // BMP data is stored little-endian, Arduino is little-endian too.
 // May need to reverse subscript order if porting elsewhere.
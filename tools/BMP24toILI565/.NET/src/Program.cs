@@ -22,6 +22,10 @@ namespace BMP24toILI565
         static private byte r, g, b;
         static private long pos = 0, startTime;
         static private bool first = true;
+        static private bool writeRuns = false; // also write a table of opaque runs for drawSpriteRuns
+        static private UInt16 transparentColor; // 565 color treated as transparent when writing the runs
+        static private bool writeRLE = false; // also write a run-length encoded array for drawImageRLE
+        static private bool writeIndexed = false; // also write a palette and an index array for drawIndexedImage
 
 
         private static void Main(string[] args)
@@ -29,6 +33,34 @@ namespace BMP24toILI565
             string codeBase = Assembly.GetExecutingAssembly().CodeBase;
             string exeFilename = Path.GetFileName(codeBase);
 
+            // -runs <565 color in hex> creates <image>Runs.h next to the .565 file
+            var runsArg = Array.IndexOf(args, "-runs");
+            if (runsArg >= 0)
+            {
+                if (runsArg + 1 >= args.Length)
+                {
+                    Console.WriteLine("Usage: {0} [image.bmp] [-runs transparentColor565] [-rle] [-indexed]", exeFilename);
+                    return;
+                }
+                writeRuns = true;
+                transparentColor = Convert.ToUInt16(args[runsArg + 1], 16);
+                args = args.Where((a, i) => i != runsArg && i != runsArg + 1).ToArray();
+            }
+
+            // -rle creates <image>RLE.h next to the .565 file
+            if (args.Contains("-rle"))
+            {
+                writeRLE = true;
+                args = args.Where(a => a != "-rle").ToArray();
+            }
+
+            // -indexed creates <image>Indexed.h next to the .565 file
+            if (args.Contains("-indexed"))
+            {
+                writeIndexed = true;
+                args = args.Where(a => a != "-indexed").ToArray();
+            }
+
             if (args.Length == 0)
             {
                 var bmpFiles = Directory.EnumerateFiles(Directory.GetCurrentDirectory(), "*.bmp").ToList();
@@ -131,6 +163,8 @@ namespace BMP24toILI565
 
                     var inRGB = new byte[3];
                     var outRGB = new byte[2];
+                    var runs = new List<UInt16>();
+                    var pixels = new List<UInt16>();
 
                     for (row = 0; row < bmpHeight; row++)
                     {
@@ -143,6 +177,10 @@ namespace BMP24toILI565
 
                         rgb24file.Seek(pos, SeekOrigin.Begin);
 
+                        var runCountIndex = runs.Count;
+                        runs.Add(0);
+                        var lastOpaque = false;
+
                         for (var c = 0; c < 3 * bmpWidth; c += 3)
                         {
                             rgb24file.Read(inRGB, 0, 3);
@@ -151,8 +189,28 @@ namespace BMP24toILI565
                             outRGB[0] = (byte)(iliColor & 0xFF);
                             outRGB[1] = (byte)(iliColor >> 8); 
                             rgb16file.Write(outRGB, 0, 2);
+                            pixels.Add(iliColor);
+
+                            var opaque = iliColor != transparentColor;
+                            if (opaque && !lastOpaque)
+                            {
+                                // new run: start column and length
+                                runs[runCountIndex]++;
+                                runs.Add((UInt16)(c / 3));
+                                runs.Add(0);
+                            }
+                            if (opaque)
+                                runs[runs.Count - 1]++;
+                            lastOpaque = opaque;
                         }
                     }
+
+                    if (writeRuns)
+                        WriteRuns(imageFilename, runs);
+                    if (writeRLE)
+                        WriteRLE(imageFilename, pixels);
+                    if (writeIndexed)
+                        WriteIndexed(imageFilename, pixels);
                 }
                 catch (Exception ex)
                 {
@@ -179,6 +237,162 @@ namespace BMP24toILI565
             }
         }
 
+        // writes the opaque runs as a PROGMEM array that can be passed to drawSpriteRuns
+        static void WriteRuns(string imageFilename, List<UInt16> runs)
+        {
+            string name = Path.GetFileNameWithoutExtension(imageFilename);
+            string runsFilename = Path.Combine(Path.GetDirectoryName(Path.GetFullPath(imageFilename)), name + "Runs.h");
+
+            using (var writer = new StreamWriter(runsFilename))
+            {
+                writer.WriteLine("#if defined(__AVR__)");
+                writer.WriteLine("    #include <avr/pgmspace.h>");
+                writer.WriteLine("#elif defined(__arm__)");
+                writer.WriteLine("    #define PROGMEM");
+                writer.WriteLine("#endif");
+                writer.WriteLine();
+                writer.WriteLine("// opaque runs of {0} (transparent color 0x{1:X4}), for each row: run count, then start and length of each run", Path.GetFileName(imageFilename), transparentColor);
+                writer.WriteLine("const uint16_t {0}Runs[{1}] PROGMEM={{", name, runs.Count);
+
+                var i = 0;
+                for (row = 0; row < bmpHeight; row++)
+                {
+                    var count = runs[i];
+                    var line = runs.Skip(i).Take(1 + 2 * count).Select(v => string.Format("0x{0:X4}", v));
+                    i += 1 + 2 * count;
+                    writer.WriteLine("{0}{1} // row {2}", string.Join(",", line), i < runs.Count ? "," : "", row);
+                }
+                writer.WriteLine("};");
+            }
+
+            Console.WriteLine("{0} created", runsFilename);
+        }
+
+        // encodes the pixels into packets for drawImageRLE:
+        // 0x8000 | count followed by one color repeats the color count times,
+        // count followed by count colors copies them as they are
+        static List<UInt16> EncodeRLE(List<UInt16> pixels)
+        {
+            const int maxCount = 0x7FFF;
+            const int minRepeat = 3; // shorter repeats are cheaper as part of a literal packet
+            var data = new List<UInt16>();
+            var p = 0;
+
+            while (p < pixels.Count)
+            {
+                var repeat = RepeatLength(pixels, p, maxCount);
+                if (repeat >= minRepeat)
+                {
+                    data.Add((UInt16)(0x8000 | repeat));
+                    data.Add(pixels[p]);
+                    p += repeat;
+                    continue;
+                }
+
+                // collect literal pixels until a repeat worth a packet of its own starts
+                var start = p;
+                while (p < pixels.Count && p - start < maxCount && RepeatLength(pixels, p, minRepeat) < minRepeat)
+                    p++;
+                data.Add((UInt16)(p - start));
+                data.AddRange(pixels.GetRange(start, p - start));
+            }
+
+            return data;
+        }
+
+        static int RepeatLength(List<UInt16> pixels, int start, int maxLength)
+        {
+            var length = 1;
+            while (start + length < pixels.Count && length < maxLength && pixels[start + length] == pixels[start])
+                length++;
+            return length;
+        }
+
+        // writes the run-length encoded image as a PROGMEM array that can be passed to drawImageRLE
+        static void WriteRLE(string imageFilename, List<UInt16> pixels)
+        {
+            string name = Path.GetFileNameWithoutExtension(imageFilename);
+            string rleFilename = Path.Combine(Path.GetDirectoryName(Path.GetFullPath(imageFilename)), name + "RLE.h");
+            var data = EncodeRLE(pixels);
+
+            using (var writer = new StreamWriter(rleFilename))
+            {
+                writer.WriteLine("#if defined(__AVR__)");
+                writer.WriteLine("    #include <avr/pgmspace.h>");
+                writer.WriteLine("#elif defined(__arm__)");
+                writer.WriteLine("    #define PROGMEM");
+                writer.WriteLine("#endif");
+                writer.WriteLine();
+                writer.WriteLine("const uint16_t {0}RLEWidth = {1};", name, bmpWidth);
+                writer.WriteLine("const uint16_t {0}RLEHeight = {1};", name, bmpHeight);
+                writer.WriteLine("// {0} pixels in {1} words", pixels.Count, data.Count);
+                writer.WriteLine("const uint16_t {0}RLE[{1}] PROGMEM={{", name, data.Count);
+                for (var i = 0; i < data.Count; i += 16)
+                {
+                    var line = data.Skip(i).Take(16).Select(v => string.Format("0x{0:X4}", v));
+                    writer.WriteLine("{0}{1}", string.Join(",", line), i + 16 < data.Count ? "," : "");
+                }
+                writer.WriteLine("};");
+            }
+
+            Console.WriteLine("{0} created ({1} bytes instead of {2})", rleFilename, data.Count * 2, pixels.Count * 2);
+        }
+
+        // writes the palette and the packed indexes for drawIndexedImage,
+        // the smallest of 1, 2, 4 and 8 bits per pixel that holds all the colors is used
+        static void WriteIndexed(string imageFilename, List<UInt16> pixels)
+        {
+            var palette = pixels.Distinct().ToList();
+            if (palette.Count > 256)
+            {
+                Console.WriteLine("{0} has {1} colors, an indexed image can have at most 256", imageFilename, palette.Count);
+                return;
+            }
+
+            int bitsPerPixel = palette.Count <= 2 ? 1 : palette.Count <= 4 ? 2 : palette.Count <= 16 ? 4 : 8;
+            var paletteIndexes = palette.Select((c, i) => new { c, i }).ToDictionary(p => p.c, p => p.i);
+
+            // pack the indexes from the most significant bit, every row starts on a new byte
+            int bytesPerRow = (bmpWidth * bitsPerPixel + 7) / 8;
+            var indexes = new byte[bytesPerRow * bmpHeight];
+            for (var y = 0; y < bmpHeight; y++)
+            {
+                for (var x = 0; x < bmpWidth; x++)
+                {
+                    var bitPos = x * bitsPerPixel;
+                    indexes[y * bytesPerRow + bitPos / 8] |= (byte)(paletteIndexes[pixels[y * bmpWidth + x]] << (8 - bitsPerPixel - bitPos % 8));
+                }
+            }
+
+            string name = Path.GetFileNameWithoutExtension(imageFilename);
+            string indexedFilename = Path.Combine(Path.GetDirectoryName(Path.GetFullPath(imageFilename)), name + "Indexed.h");
+
+            using (var writer = new StreamWriter(indexedFilename))
+            {
+                writer.WriteLine("#if defined(__AVR__)");
+                writer.WriteLine("    #include <avr/pgmspace.h>");
+                writer.WriteLine("#elif defined(__arm__)");
+                writer.WriteLine("    #define PROGMEM");
+                writer.WriteLine("#endif");
+                writer.WriteLine();
+                writer.WriteLine("const uint16_t {0}IndexedWidth = {1};", name, bmpWidth);
+                writer.WriteLine("const uint16_t {0}IndexedHeight = {1};", name, bmpHeight);
+                writer.WriteLine("const uint8_t {0}IndexedBitsPerPixel = {1};", name, bitsPerPixel);
+                writer.WriteLine("const uint16_t {0}Palette[{1}] PROGMEM={{", name, palette.Count);
+                writer.WriteLine(string.Join(",", palette.Select(c => string.Format("0x{0:X4}", c))));
+                writer.WriteLine("};");
+                writer.WriteLine("const uint8_t {0}Indexed[{1}] PROGMEM={{", name, indexes.Length);
+                for (var y = 0; y < bmpHeight; y++)
+                {
+                    var line = indexes.Skip(y * bytesPerRow).Take(bytesPerRow).Select(v => string.Format("0x{0:X2}", v));
+                    writer.WriteLine("{0}{1} // row {2}", string.Join(",", line), y + 1 < bmpHeight ? "," : "", y);
+                }
+                writer.WriteLine("};");
+            }
+
+            Console.WriteLine("{0} created ({1} colors, {2} bpp, {3} bytes instead of {4})", indexedFilename, palette.Count, bitsPerPixel, palette.Count * 2 + indexes.Length, pixels.Count * 2);
+        }
+
         static private UInt16 to565(byte r, byte g, byte b)
         {
             return (UInt16)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
@@ -1,211 +1,354 @@
-// BMP24toILI565.cpp : Defines the entry point for the console application.
+// BMP24toILI565.cpp : converts BMP images to the .565 format (RGB565 pixels after a 54 byte BMP header)
+// that can be loaded from an SD card quickly (see the sdFatTftBitmap example)
 //
+// Usage: BMP24toILI565 [-rle] [-j threads] [file.bmp|directory ...]
+//   without files or directories all .bmp files in the current directory are converted
+//   -rle  also write a run-length encoded array for drawImageRLE (<name>RLE.h)
+//   -j    number of images converted in parallel (default: number of cores)
+//
+// Accepts uncompressed 24 and 32 bit BMPs (32 bit also with BI_BITFIELDS in BGRA order),
+// stored bottom-up or top-down. Builds with any C++17 compiler (make on Linux, the .sln on Windows).
 
-#include "stdafx.h"
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <ctype.h>
 #include <string.h>
-#include <windows.h>
-#include "dirent.h"
-
-FILE *rgb24file;
-FILE *rgb16file;
-int bmpWidth, bmpHeight;   // W+H in pixels
-UINT16  bmpDepth;              // Bit depth (currently must be 24)
-UINT32 bmpImageoffset;        // Start of image data in file
-UINT32 rowSize;               // Not always = bmpWidth; may have padding
-boolean  goodBmp = false;       // Set to true on valid header parse
-boolean  flip = true;        // BMP is stored bottom-to-top
-UINT16 w, h, row, col;
-UINT8  r, g, b;
-UINT32 pos = 0, startTime;
-bool  first = true;
-DIR* dir;
-struct dirent *ent;
-
-
-//inline UINT16 read16(FILE *file)
-//{
-//	UINT16 word;
-//	fread(&word, 2, 1, file);
-//	return word;
-//}
-
-//inline UINT16 read32(FILE *file)
-//{
-//	UINT32 dword;
-//	fread(&dword, 4, 1, file);
-//	return dword;
-//}
-
-UINT16 read16(FILE *file) {
-	UINT16 word;
-	fread(&(((UINT8 *)&word)[0]), 1, 1, file);
-	fread(&(((UINT8 *)&word)[1]), 1, 1, file);
-	//((UINT8 *)&word)[0] = f.read(); // LSB
-	//((UINT8 *)&word)[1] = f.read(); // MSB
-	return word;
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+#define BMP_HEADER_SIZE 54
+#define BI_RGB 0
+#define BI_BITFIELDS 3
+
+#define RLE_MAX_COUNT 0x7FFF
+#define RLE_MIN_REPEAT 3	// shorter repeats are cheaper as part of a literal packet
+
+bool writeRLE = false;	// also write a run-length encoded array for drawImageRLE (-rle)
+std::mutex printMutex;	// keeps the messages of images converted in parallel apart
+
+inline uint16_t read16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
 }
-//
-UINT32 read32(FILE *file) {
-	UINT32 dword;
-	fread(&(((UINT8 *)&dword)[0]), 1, 1, file);
-	fread(&(((UINT8 *)&dword)[1]), 1, 1, file);
-	fread(&(((UINT8 *)&dword)[2]), 1, 1, file);
-	fread(&(((UINT8 *)&dword)[3]), 1, 1, file);
-	return dword;
+
+inline uint32_t read32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
 }
 
-inline UINT16 to565(UINT8 r, UINT8 g, UINT8 b)
+inline void write16(uint8_t *p, uint16_t v)
+{
+	p[0] = v & 0xFF;
+	p[1] = v >> 8;
+}
+
+inline void write32(uint8_t *p, uint32_t v)
+{
+	write16(p, v & 0xFFFF);
+	write16(p + 2, v >> 16);
+}
+
+inline uint16_t to565(uint8_t r, uint8_t g, uint8_t b)
 {
 	return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
-	//return ((red >> 3) << 11) | ((green >> 2) << 5) | (blue >> 3);
 }
 
-int convertImage(char* filename)
+// converts one row of BGR (3 bytes per pixel) or BGRA (4 bytes per pixel) to RGB565
+// kept free of branches so the compiler can vectorize it
+template<int bytesPerPixel>
+void convertRow(const uint8_t *in, uint16_t *out, uint32_t width)
 {
-	try
+	for (uint32_t x = 0; x < width; x++)
 	{
-		printf("\n");
-		printf("Converting %s...\n", filename);
-		rgb24file = fopen(filename, "rb");
-		if (rgb24file == NULL)
-		{
-			printf("Could not find file %s \n", filename);
-			return -1;
-		}
-
-		fseek(rgb24file, 0, SEEK_SET);
+		const uint8_t *p = in + x * bytesPerPixel;
+		out[x] = to565(p[2], p[1], p[0]);
+	}
+}
 
-		if (read16(rgb24file) != 0x4D42)  // BMP signature
-		{
-			printf("Not a BMP file.\n");
-			return -1;
-		}
+int repeatLength(const std::vector<uint16_t> &pixels, uint32_t start, int maxLength)
+{
+	const uint32_t count = (uint32_t)pixels.size();
+	int length = 1;
+	while (start + length < count && length < maxLength && pixels[start + length] == pixels[start])
+		length++;
+	return length;
+}
 
-		printf("File size: %u\n", read32(rgb24file));
-		(void)read32(rgb24file); // Read & ignore creator bytes
-		bmpImageoffset = read32(rgb24file); // Start of image data
-		printf("Image Offset: %d\n", bmpImageoffset);
-		// Read DIB header
-		printf("Header size: %d\n", read32(rgb24file));
-		bmpWidth = read32(rgb24file);
-		bmpHeight = read32(rgb24file);
+// encodes the pixels into packets for drawImageRLE:
+// 0x8000 | count followed by one color repeats the color count times,
+// count followed by count colors copies them as they are
+std::vector<uint16_t> encodeRLE(const std::vector<uint16_t> &pixels)
+{
+	const uint32_t count = (uint32_t)pixels.size();
+	std::vector<uint16_t> out;
+	out.reserve(count + count / RLE_MAX_COUNT + 1);
 
-		if (read16(rgb24file) != 1) // # planes -- must be '1'
+	uint32_t p = 0;
+	while (p < count)
+	{
+		int repeat = repeatLength(pixels, p, RLE_MAX_COUNT);
+		if (repeat >= RLE_MIN_REPEAT)
 		{
-			printf("Number of planes must be 1\n");
-			return -1;
+			out.push_back(0x8000 | repeat);
+			out.push_back(pixels[p]);
+			p += repeat;
+			continue;
 		}
 
-		bmpDepth = read16(rgb24file); // bits per pixel
-		printf("Bit Depth: %d\n", bmpDepth);
+		// collect literal pixels until a repeat worth a packet of its own starts
+		uint32_t start = p;
+		while (p < count && p - start < RLE_MAX_COUNT && repeatLength(pixels, p, RLE_MIN_REPEAT) < RLE_MIN_REPEAT)
+			p++;
+		out.push_back((uint16_t)(p - start));
+		out.insert(out.end(), pixels.begin() + start, pixels.begin() + p);
+	}
+	return out;
+}
 
-		if (bmpDepth != 24)
-		{
-			printf("Image is not in 24bit\n");
-			return -1;
-		}
+// writes the run-length encoded image as a PROGMEM array that can be passed to drawImageRLE
+bool writeRLEFile(const fs::path &bmpPath, const std::vector<uint16_t> &pixels, uint32_t width, uint32_t height, std::string &log)
+{
+	const std::string name = bmpPath.stem().string();
+	const fs::path rlePath = bmpPath.parent_path() / (name + "RLE.h");
+	const std::vector<uint16_t> data = encodeRLE(pixels);
 
-		if (read32(rgb24file) != 0)  // 0 = uncompressed
-		{
-			printf("BMP must be in uncompressed format\n");
-			return -1;
-		}
+	FILE *rleFile = fopen(rlePath.string().c_str(), "w");
+	if (rleFile == NULL)
+	{
+		log += "Could not create file " + rlePath.string() + "\n";
+		return false;
+	}
 
-		goodBmp = true; // Supported BMP format -- proceed!
-		printf("Image size: %dx%d\n", bmpWidth, bmpHeight);
+	fprintf(rleFile, "#if defined(__AVR__)\n    #include <avr/pgmspace.h>\n#elif defined(__arm__)\n    #define PROGMEM\n#endif\n\n");
+	fprintf(rleFile, "const uint16_t %sRLEWidth = %u;\n", name.c_str(), width);
+	fprintf(rleFile, "const uint16_t %sRLEHeight = %u;\n", name.c_str(), height);
+	fprintf(rleFile, "// %u pixels in %u words\n", (uint32_t)pixels.size(), (uint32_t)data.size());
+	fprintf(rleFile, "const uint16_t %sRLE[%u] PROGMEM={\n", name.c_str(), (uint32_t)data.size());
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		fprintf(rleFile, "0x%04X%s", data[i], i + 1 < data.size() ? "," : "");
+		if (i % 16 == 15 || i + 1 == data.size())
+			fprintf(rleFile, "\n");
+	}
+	fprintf(rleFile, "};\n");
+	fclose(rleFile);
+
+	char message[512];
+	snprintf(message, sizeof(message), "%s created (%u bytes instead of %u)\n", rlePath.string().c_str(),
+		(uint32_t)data.size() * 2, (uint32_t)pixels.size() * 2);
+	log += message;
+	return true;
+}
 
-		char outFilename[255];
-		sprintf(outFilename, "%s", filename);
-		sprintf(outFilename + strlen(filename) - 3, "565");
+// reads the whole file with one read
+bool readFile(const fs::path &path, std::vector<uint8_t> &data)
+{
+	FILE *file = fopen(path.string().c_str(), "rb");
+	if (file == NULL)
+		return false;
+	fseek(file, 0, SEEK_END);
+	const long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	data.resize(size > 0 ? size : 0);
+	const bool ok = size > 0 && fread(data.data(), 1, data.size(), file) == data.size();
+	fclose(file);
+	return ok;
+}
 
-		printf("%s created\n", outFilename);
-		rgb16file = fopen(outFilename, "wb");
+bool convertImage(const fs::path &bmpPath, std::string &log)
+{
+	std::vector<uint8_t> bmp;
+	if (!readFile(bmpPath, bmp))
+	{
+		log += "Could not read file " + bmpPath.string() + "\n";
+		return false;
+	}
 
-		if (rgb16file == NULL)
-		{
-			printf("Could not create file %s\n", outFilename);
-			return -1;
-		}
+	if (bmp.size() < BMP_HEADER_SIZE || read16(&bmp[0]) != 0x4D42)  // BMP signature
+	{
+		log += "Not a BMP file.\n";
+		return false;
+	}
 
-		UINT8 header[54];
-		fseek(rgb24file, 0, SEEK_SET);
-		fread(header, 1, 54, rgb24file);
+	const uint32_t imageOffset = read32(&bmp[0x0A]);	// start of image data
+	const int32_t bmpWidth = (int32_t)read32(&bmp[0x12]);
+	int32_t bmpHeight = (int32_t)read32(&bmp[0x16]);
+	const uint16_t depth = read16(&bmp[0x1C]);
+	const uint32_t compression = read32(&bmp[0x1E]);
 
-		header[0x1C] = 16;	// updage bit depth to 16 bpp
+	if (read16(&bmp[0x1A]) != 1)	// # planes -- must be '1'
+	{
+		log += "Number of planes must be 1\n";
+		return false;
+	}
+	if (depth != 24 && depth != 32)
+	{
+		log += "Image is not in 24 or 32 bit\n";
+		return false;
+	}
+	// 32 bit images may describe their BGRA layout with bit fields, only that layout is supported
+	const bool bgraFields = depth == 32 && compression == BI_BITFIELDS && bmp.size() >= BMP_HEADER_SIZE + 12 &&
+		read32(&bmp[0x36]) == 0x00FF0000 && read32(&bmp[0x3A]) == 0x0000FF00 && read32(&bmp[0x3E]) == 0x000000FF;
+	if (compression != BI_RGB && !bgraFields)
+	{
+		log += "BMP must be in uncompressed format\n";
+		return false;
+	}
 
-		fwrite(header, 1, 54, rgb16file);
+	// if bmpHeight is negative, image is in top-down order
+	const bool flip = bmpHeight > 0;
+	if (bmpHeight < 0)
+		bmpHeight = -bmpHeight;
+	if (bmpWidth <= 0 || bmpHeight == 0 || bmpWidth > 0xFFFF || bmpHeight > 0xFFFF)
+	{
+		log += "Unsupported image size\n";
+		return false;
+	}
+	const uint32_t width = bmpWidth, height = bmpHeight;
 
-		// BMP rows are padded (if needed) to 4-byte boundary
-		rowSize = (bmpWidth * 3 + 3) & ~3;
+	// BMP rows are padded (if needed) to 4-byte boundary
+	const uint32_t bytesPerPixel = depth / 8;
+	const uint32_t rowSize = (width * bytesPerPixel + 3) & ~3;
+	if ((uint64_t)imageOffset + (uint64_t)rowSize * height > bmp.size())
+	{
+		log += "BMP file is truncated\n";
+		return false;
+	}
 
-		// If bmpHeight is negative, image is in top-down order.
-		// This is not canon but has been observed in the wild.
-		if (bmpHeight < 0) {
-			bmpHeight = -bmpHeight;
-			flip = false;
-		}
+	std::vector<uint16_t> pixels((size_t)width * height);
+	for (uint32_t row = 0; row < height; row++)
+	{
+		const uint8_t *in = &bmp[imageOffset + (size_t)(flip ? height - 1 - row : row) * rowSize];
+		if (bytesPerPixel == 3)
+			convertRow<3>(in, &pixels[(size_t)row * width], width);
+		else
+			convertRow<4>(in, &pixels[(size_t)row * width], width);
+	}
 
-		UINT8 inRGB[3], outRGB[2];
+	// 54 byte header of a 16 bit top-down image followed by the pixels, little endian
+	std::vector<uint8_t> out(BMP_HEADER_SIZE + pixels.size() * 2, 0);
+	write16(&out[0], 0x4D42);
+	write32(&out[0x02], (uint32_t)out.size());
+	write32(&out[0x0A], BMP_HEADER_SIZE);
+	write32(&out[0x0E], 40);
+	write32(&out[0x12], width);
+	write32(&out[0x16], height);
+	write16(&out[0x1A], 1);
+	write16(&out[0x1C], 16);
+	write32(&out[0x22], (uint32_t)pixels.size() * 2);
+	memcpy(&out[0x26], &bmp[0x26], 8);	// resolution
+	uint8_t *outPixels = &out[BMP_HEADER_SIZE];
+	for (size_t i = 0; i < pixels.size(); i++)
+		write16(outPixels + i * 2, pixels[i]);
+
+	fs::path outPath = bmpPath;
+	outPath.replace_extension(".565");
+	FILE *rgb16file = fopen(outPath.string().c_str(), "wb");
+	if (rgb16file == NULL)
+	{
+		log += "Could not create file " + outPath.string() + "\n";
+		return false;
+	}
+	const bool written = fwrite(out.data(), 1, out.size(), rgb16file) == out.size();
+	if (fclose(rgb16file) != 0 || !written)
+	{
+		log += "Could not write file " + outPath.string() + "\n";
+		return false;
+	}
 
-		for (row = 0; row < bmpHeight; row++) { // For each scanline...
+	char message[512];
+	snprintf(message, sizeof(message), "%s created (%ux%u, %u bit%s)\n", outPath.string().c_str(),
+		width, height, depth, flip ? "" : ", top-down");
+	log += message;
 
-			if (flip) // Bitmap is stored bottom-to-top order (normal BMP)
-				pos = bmpImageoffset + (bmpHeight - 1 - row) * rowSize;
-			else     // Bitmap is stored top-to-bottom
-				pos = bmpImageoffset + row * rowSize;
+	if (writeRLE)
+		return writeRLEFile(bmpPath, pixels, width, height, log);
+	return true;
+}
 
-			fseek(rgb24file, pos, SEEK_SET);
+bool isBmp(const fs::path &path)
+{
+	std::string ext = path.extension().string();
+	for (char &c : ext)
+		c = (char)tolower((unsigned char)c);
+	return ext == ".bmp";
+}
 
-			for (UINT16 c = 0; c < 3 * bmpWidth; c += 3)
-			{
-				fread(inRGB, 1, 3, rgb24file);
-				UINT16 iliColor = to565(inRGB[2], inRGB[1], inRGB[0]);
-				outRGB[0] = iliColor & 0xFF;
-				outRGB[1] = iliColor >> 8;
-				fwrite(outRGB, 1, 2, rgb16file);
-			}
-		}
-	}
-	catch (...)
+// adds the .bmp files of a directory (not its subdirectories)
+void addDirectory(const fs::path &dir, std::vector<fs::path> &files)
+{
+	std::error_code error;
+	for (const fs::directory_entry &entry : fs::directory_iterator(dir, error))
 	{
-		printf("Error converting file\n");
+		if (entry.is_regular_file(error) && isBmp(entry.path()))
+			files.push_back(entry.path());
 	}
-
-	_fcloseall();
+	if (error)
+		printf("Could not read directory %s: %s\n", dir.string().c_str(), error.message().c_str());
 }
 
 int main(int argc, char *argv[])
 {
-	if (argc == 1)
-	{
-		if ((dir = opendir(".")) != NULL) {
-			/* print all the files and directories within directory */
-			int bmpFilesFound = 0;
-			while ((ent = readdir(dir)) != NULL) {
-				if (strncmp(ent->d_name + ent->d_namlen - 4, ".bmp", 4) == 0)
-				{
-					convertImage(ent->d_name);
-					bmpFilesFound++;
-				}
-			}
-			closedir(dir);
-			if (bmpFilesFound == 0)
-			{
-				printf("\n");
-				printf("No .bmp files found.\n");
-			}
-		}
-		else {
-			/* could not open directory */
-			perror("");
-			return EXIT_FAILURE;
+	std::vector<fs::path> files;
+	unsigned threadCount = std::thread::hardware_concurrency();
+	bool pathGiven = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-rle") == 0)
+			writeRLE = true;
+		else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			threadCount = (unsigned)atoi(argv[++i]);
+		else
+		{
+			pathGiven = true;
+			if (fs::is_directory(argv[i]))
+				addDirectory(argv[i], files);
+			else
+				files.push_back(argv[i]);
 		}
 	}
-	else
+	if (!pathGiven)
+		addDirectory(".", files);
+
+	if (files.empty())
 	{
-		convertImage(argv[1]);
+		printf("No .bmp files found.\n");
+		return EXIT_FAILURE;
 	}
 
+	// each thread takes the next image until all are converted
+	if (threadCount == 0)
+		threadCount = 1;
+	if (threadCount > files.size())
+		threadCount = (unsigned)files.size();
+	std::atomic<size_t> next(0);
+	std::atomic<unsigned> failed(0);
+	auto worker = [&]() {
+		for (size_t i = next++; i < files.size(); i = next++)
+		{
+			std::string log = "Converting " + files[i].string() + "...\n";
+			if (!convertImage(files[i], log))
+				failed++;
+			std::lock_guard<std::mutex> lock(printMutex);
+			fputs(log.c_str(), stdout);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned t = 1; t < threadCount; t++)
+		threads.emplace_back(worker);
+	worker();
+	for (std::thread &thread : threads)
+		thread.join();
 
+	printf("%u of %u images converted\n", (unsigned)(files.size() - failed), (unsigned)files.size());
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
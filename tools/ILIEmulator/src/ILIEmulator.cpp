@@ -0,0 +1,505 @@
+/*
+ILIEmulator.cpp - host-side ILI9341 command stream emulator
+
+Code: https://github.com/marekburiak/ILI9341_due
+Documentation: http://marekburiak.github.io/ILI9341_due/
+
+Copyright (c) 2015  Marek Buriak
+
+*/
+
+#include <string.h>
+#include "ILIEmulator.h"
+#include "Arduino.h"
+
+#define EMU_MADCTL_MY  0x80
+#define EMU_MADCTL_MX  0x40
+#define EMU_MADCTL_MV  0x20
+#define EMU_MADCTL_BGR 0x08
+
+static ILIEmulator *s_emulator = NULL;
+
+static uint8_t emuTransfer(uint8_t b)
+{
+	return s_emulator ? s_emulator->transfer(b) : 0;
+}
+
+static void emuPinChanged(uint8_t pin)
+{
+	if (s_emulator)
+		s_emulator->pinChanged(pin);
+}
+
+ILIEmulator::ILIEmulator()
+{
+	_cs = 0xFF;
+	_dc = 0xFF;
+	_csLow = false;
+	reset();
+	resetCounters();
+}
+
+void ILIEmulator::attach(uint8_t csPin, uint8_t dcPin)
+{
+	_cs = csPin;
+	_dc = dcPin;
+	s_emulator = this;
+	g_hostSpiTransfer = emuTransfer;
+	g_hostPinChanged = emuPinChanged;
+}
+
+void ILIEmulator::pinChanged(uint8_t pin)
+{
+	if (pin != _cs)
+		return;
+	const bool csLow = (g_hostPins[_cs].value & 1) == 0;
+	if (csLow && !_csLow)
+		_counters.csToggles++;
+	_csLow = csLow;
+}
+
+void ILIEmulator::reset()
+{
+	memset(_gram, 0, sizeof(_gram));
+	_cmd = 0;
+	_paramCount = 0;
+	_readIndex = 0;
+	_readIndexOverride = 0;
+	_respLen = 0;
+	_colStart = 0; _colEnd = ILI_EMU_WIDTH - 1;
+	_pageStart = 0; _pageEnd = ILI_EMU_HEIGHT - 1;
+	_col = 0; _page = 0;
+	_pixHalf = false;
+	_readBufPos = 3;
+	_readDummyDone = false;
+	_madctl = 0;
+	_pixfmt = 0x66;
+	_tfa = 0; _vsa = ILI_EMU_HEIGHT; _bfa = 0; _vsp = 0;
+	_sleep = true;
+	_displayOn = false;
+	_inverted = false;
+	_idle = false;
+	_teOn = false;
+	_teMode = 0;
+}
+
+void ILIEmulator::resetCounters()
+{
+	memset(&_counters, 0, sizeof(_counters));
+}
+
+uint8_t ILIEmulator::transfer(uint8_t b)
+{
+	const bool csLow = _cs == 0xFF || (g_hostPins[_cs].value & 1) == 0;
+	if (!csLow)
+		return 0xFF;	// not selected, nobody drives MISO
+
+	_counters.bytes++;
+	const bool isData = _dc == 0xFF || (g_hostPins[_dc].value & 1) != 0;
+	if (!isData)
+	{
+		_counters.commandBytes++;
+		command(b);
+		return 0;
+	}
+	_counters.dataBytes++;
+	if (_respLen > 0 || _cmd == 0x2E || _cmd == 0x3E)
+	{
+		_counters.readBytes++;
+		return readByte();
+	}
+	data(b);
+	return 0;
+}
+
+void ILIEmulator::command(uint8_t c)
+{
+	_counters.commands[c]++;
+	_cmd = c;
+	_paramCount = 0;
+	_respLen = 0;
+	_readIndex = _readIndexOverride;
+	_readIndexOverride = 0;
+
+	switch (c)
+	{
+	case 0x01:	// SWRESET
+		reset();
+		break;
+	case 0x04:	// RDDID
+		_resp[0] = 0; _resp[1] = 0x00; _resp[2] = 0x93; _resp[3] = 0x41; _respLen = 4;
+		break;
+	case 0x09:	// RDDST
+		_resp[0] = 0;
+		_resp[1] = (_madctl & 0xF8) | (_sleep ? 0 : 0x80) | 0x00;
+		_resp[2] = ((_pixfmt & 0x07) << 4) | (_idle ? 0x08 : 0) | (_sleep ? 0 : 0x04) | 0x02;
+		_resp[3] = (_inverted ? 0x20 : 0) | (_displayOn ? 0x04 : 0);
+		_resp[4] = _teMode ? 0x40 : 0;
+		_respLen = 5;
+		break;
+	case 0x0A:	// RDMODE
+		_resp[0] = 0;
+		_resp[1] = (_sleep ? 0 : 0x80) | (_idle ? 0x40 : 0) | (_sleep ? 0 : 0x10) | 0x08 | (_displayOn ? 0x04 : 0);
+		_respLen = 2;
+		break;
+	case 0x0B:	// RDMADCTL
+		_resp[0] = 0; _resp[1] = _madctl; _respLen = 2;
+		break;
+	case 0x0C:	// RDPIXFMT
+		_resp[0] = 0; _resp[1] = _pixfmt; _respLen = 2;
+		break;
+	case 0x0D:	// RDIMGFMT
+	case 0x0E:	// RDSIGMODE
+		_resp[0] = 0; _resp[1] = 0; _respLen = 2;
+		break;
+	case 0x0F:	// RDSELFDIAG
+		_resp[0] = 0; _resp[1] = 0xC0; _respLen = 2;
+		break;
+	case 0x45:	// GETSCAN, the refresh is simulated as advancing one line every ILI_EMU_BYTES_PER_LINE bytes on the bus
+	{
+		const uint16_t line = (_counters.bytes / ILI_EMU_BYTES_PER_LINE) % ILI_EMU_LINES_PER_FRAME;
+		_resp[0] = 0; _resp[1] = line >> 8; _resp[2] = line & 0xFF; _respLen = 3;
+		break;
+	}
+	case 0x10: _sleep = true; break;
+	case 0x11: _sleep = false; break;
+	case 0x13: _tfa = 0; _vsa = ILI_EMU_HEIGHT; _bfa = 0; _vsp = 0; break;	// NORON
+	case 0x20: _inverted = false; break;
+	case 0x21: _inverted = true; break;
+	case 0x28: _displayOn = false; break;
+	case 0x29: _displayOn = true; break;
+	case 0x2A: case 0x2B: _counters.windowSets++; break;
+	case 0x2C:	// RAMWR
+		_counters.ramWrites++;
+		_col = _colStart;
+		_page = _pageStart;
+		_pixHalf = false;
+		break;
+	case 0x2E:	// RAMRD
+		_col = _colStart;
+		_page = _pageStart;
+		_readBufPos = 3;
+		_readDummyDone = false;
+		break;
+	case 0x3C:	// RAMWR continue
+		_pixHalf = false;
+		break;
+	case 0x3E:	// RAMRD continue
+		_readBufPos = 3;
+		_readDummyDone = false;
+		break;
+	case 0x34: _teOn = false; break;	// TEOFF
+	case 0x35: _teOn = true; _teMode = 0; break;	// TEON
+	case 0x38: _idle = false; break;
+	case 0x39: _idle = true; break;
+	case 0xD3:	// RDID4
+		_resp[0] = 0; _resp[1] = 0x00; _resp[2] = 0x93; _resp[3] = 0x41; _respLen = 4;
+		break;
+	case 0xDA: _resp[0] = 0; _resp[1] = 0x00; _respLen = 2; break;	// RDID1
+	case 0xDB: _resp[0] = 0; _resp[1] = 0x93; _respLen = 2; break;	// RDID2
+	case 0xDC: _resp[0] = 0; _resp[1] = 0x41; _respLen = 2; break;	// RDID3
+	default:
+		break;
+	}
+}
+
+void ILIEmulator::data(uint8_t d)
+{
+	if (_cmd == 0x2C || _cmd == 0x3C)
+	{
+		_counters.pixelBytes++;
+		if (!_pixHalf)
+		{
+			_pixHi = d;
+			_pixHalf = true;
+		}
+		else
+		{
+			_pixHalf = false;
+			writePixel(((uint16_t)_pixHi << 8) | d);
+		}
+		return;
+	}
+
+	if (_paramCount < sizeof(_params))
+		_params[_paramCount] = d;
+	_paramCount++;
+
+	switch (_cmd)
+	{
+	case 0x2A:	// CASET
+		if (_paramCount == 2) _colStart = (_params[0] << 8) | _params[1];
+		if (_paramCount == 4) _colEnd = (_params[2] << 8) | _params[3];
+		break;
+	case 0x2B:	// PASET
+		if (_paramCount == 2) _pageStart = (_params[0] << 8) | _params[1];
+		if (_paramCount == 4) _pageEnd = (_params[2] << 8) | _params[3];
+		break;
+	case 0x33:	// VSCRDEF
+		if (_paramCount == 6)
+		{
+			_tfa = (_params[0] << 8) | _params[1];
+			_vsa = (_params[2] << 8) | _params[3];
+			_bfa = (_params[4] << 8) | _params[5];
+		}
+		break;
+	case 0x35:	// TEON
+		_teMode = d & 1;
+		break;
+	case 0x36:	// MADCTL
+		_madctl = d;
+		break;
+	case 0x37:	// VSCRSADD
+		if (_paramCount == 2) _vsp = (_params[0] << 8) | _params[1];
+		break;
+	case 0x3A:	// PIXFMT
+		_pixfmt = d;
+		break;
+	case 0xD9:	// index for the next register read
+		_readIndexOverride = (d & 0x0F) + 1;	// skips the dummy byte, like the real controller
+		break;
+	default:
+		break;
+	}
+}
+
+uint8_t ILIEmulator::readByte()
+{
+	if (_cmd == 0x2E || _cmd == 0x3E)
+	{
+		if (!_readDummyDone)
+		{
+			_readDummyDone = true;
+			return 0;
+		}
+		if (_readBufPos >= 3)
+			readPixelBytes();
+		return _readBuf[_readBufPos++];
+	}
+	uint8_t i = _readIndex++;
+	return i < _respLen ? _resp[i] : 0;
+}
+
+void ILIEmulator::mapAddress(uint16_t col, uint16_t page, uint16_t *px, uint16_t *py) const
+{
+	uint16_t c = col, p = page;
+	if (_madctl & EMU_MADCTL_MV)
+	{
+		c = page;
+		p = col;
+	}
+	if (c >= ILI_EMU_WIDTH) c = ILI_EMU_WIDTH - 1;
+	if (p >= ILI_EMU_HEIGHT) p = ILI_EMU_HEIGHT - 1;
+	uint16_t pc = (_madctl & EMU_MADCTL_MX) ? ILI_EMU_WIDTH - 1 - c : c;
+	uint16_t pr = (_madctl & EMU_MADCTL_MY) ? ILI_EMU_HEIGHT - 1 - p : p;
+	// the panel is mounted so that MX gives the natural orientation
+	*px = ILI_EMU_WIDTH - 1 - pc;
+	*py = pr;
+}
+
+void ILIEmulator::advance()
+{
+	if (++_col > _colEnd)
+	{
+		_col = _colStart;
+		if (++_page > _pageEnd)
+			_page = _pageStart;
+	}
+}
+
+void ILIEmulator::writePixel(uint16_t color)
+{
+	uint16_t x, y;
+	mapAddress(_col, _page, &x, &y);
+	uint8_t r5 = color >> 11, g6 = (color >> 5) & 0x3F, b5 = color & 0x1F;
+	uint8_t r6 = (r5 << 1) | (r5 >> 4), b6 = (b5 << 1) | (b5 >> 4);
+	if (!(_madctl & EMU_MADCTL_BGR))
+	{
+		uint8_t t = r6; r6 = b6; b6 = t;
+	}
+	_gram[y][x] = ((uint32_t)(r6 << 2) << 16) | ((uint32_t)(g6 << 2) << 8) | (uint32_t)(b6 << 2);
+	_counters.pixelsWritten++;
+	advance();
+}
+
+void ILIEmulator::readPixelBytes()
+{
+	uint16_t x, y;
+	mapAddress(_col, _page, &x, &y);
+	uint32_t c = _gram[y][x];
+	uint8_t r = c >> 16, g = c >> 8, b = c;
+	if (!(_madctl & EMU_MADCTL_BGR))
+	{
+		uint8_t t = r; r = b; b = t;
+	}
+	_readBuf[0] = r;
+	_readBuf[1] = g;
+	_readBuf[2] = b;
+	_readBufPos = 0;
+	_counters.pixelsRead++;
+	advance();
+}
+
+uint32_t ILIEmulator::pixelRGB(uint16_t x, uint16_t y) const
+{
+	uint32_t c = _gram[y][x];
+	// replicate the top bits into the bottom 2 so that full scale is 0xFF
+	return c | ((c >> 6) & 0x030303);
+}
+
+uint16_t ILIEmulator::pixel565(uint16_t x, uint16_t y) const
+{
+	uint32_t c = _gram[y][x];
+	return (uint16_t)((((c >> 16) & 0xF8) << 8) | (((c >> 8) & 0xFC) << 3) | ((c & 0xF8) >> 3));
+}
+
+void ILIEmulator::displayedRow(uint16_t y, uint16_t *memRow) const
+{
+	*memRow = y;
+	if (_vsa > 0 && y >= _tfa && y < _tfa + _vsa && _vsp >= _tfa && _vsp < _tfa + _vsa)
+		*memRow = _tfa + (y - _tfa + _vsp - _tfa) % _vsa;
+}
+
+uint32_t ILIEmulator::displayedRGB(uint16_t x, uint16_t y) const
+{
+	uint16_t row;
+	displayedRow(y, &row);
+	uint32_t c = pixelRGB(x, row);
+	if (_inverted)
+		c ^= 0xFFFFFF;
+	return c;
+}
+
+bool ILIEmulator::savePPM(const char *filename) const
+{
+	FILE *f = fopen(filename, "wb");
+	if (!f)
+		return false;
+	fprintf(f, "P6\n%d %d\n255\n", ILI_EMU_WIDTH, ILI_EMU_HEIGHT);
+	for (uint16_t y = 0; y < ILI_EMU_HEIGHT; y++)
+	{
+		uint8_t row[ILI_EMU_WIDTH * 3];
+		for (uint16_t x = 0; x < ILI_EMU_WIDTH; x++)
+		{
+			uint32_t c = displayedRGB(x, y);
+			row[x * 3] = c >> 16;
+			row[x * 3 + 1] = c >> 8;
+			row[x * 3 + 2] = c;
+		}
+		fwrite(row, 1, sizeof(row), f);
+	}
+	fclose(f);
+	return true;
+}
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t *buf, size_t n)
+{
+	static uint32_t table[256];
+	if (table[1] == 0)
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+	}
+	crc = ~crc;
+	while (n--)
+		crc = table[(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+static void putBE32(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static void writeChunk(FILE *f, const char *type, const uint8_t *data, uint32_t len)
+{
+	uint8_t hdr[8];
+	putBE32(hdr, len);
+	memcpy(hdr + 4, type, 4);
+	fwrite(hdr, 1, 8, f);
+	if (len)
+		fwrite(data, 1, len, f);
+	uint32_t crc = crc32Update(0, hdr + 4, 4);
+	crc = crc32Update(crc, data, len);
+	uint8_t c[4];
+	putBE32(c, crc);
+	fwrite(c, 1, 4, f);
+}
+
+// PNG with "stored" (uncompressed) deflate blocks, no zlib needed
+bool ILIEmulator::savePNG(const char *filename) const
+{
+	FILE *f = fopen(filename, "wb");
+	if (!f)
+		return false;
+	static const uint8_t sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	fwrite(sig, 1, 8, f);
+
+	uint8_t ihdr[13];
+	putBE32(ihdr, ILI_EMU_WIDTH);
+	putBE32(ihdr + 4, ILI_EMU_HEIGHT);
+	ihdr[8] = 8;	// bit depth
+	ihdr[9] = 2;	// RGB
+	ihdr[10] = 0; ihdr[11] = 0; ihdr[12] = 0;
+	writeChunk(f, "IHDR", ihdr, sizeof(ihdr));
+
+	const uint32_t rowLen = 1 + ILI_EMU_WIDTH * 3;
+	const uint32_t rawLen = rowLen * ILI_EMU_HEIGHT;
+	uint8_t *raw = new uint8_t[rawLen];
+	uint8_t *p = raw;
+	for (uint16_t y = 0; y < ILI_EMU_HEIGHT; y++)
+	{
+		*p++ = 0;	// filter: none
+		for (uint16_t x = 0; x < ILI_EMU_WIDTH; x++)
+		{
+			uint32_t c = displayedRGB(x, y);
+			*p++ = c >> 16;
+			*p++ = c >> 8;
+			*p++ = c;
+		}
+	}
+
+	const uint32_t blockMax = 65535;
+	uint32_t blocks = (rawLen + blockMax - 1) / blockMax;
+	uint32_t zLen = 2 + blocks * 5 + rawLen + 4;
+	uint8_t *z = new uint8_t[zLen];
+	uint8_t *q = z;
+	*q++ = 0x78;
+	*q++ = 0x01;
+	uint32_t a = 1, b = 0;
+	for (uint32_t off = 0; off < rawLen; off += blockMax)
+	{
+		uint32_t len = rawLen - off < blockMax ? rawLen - off : blockMax;
+		*q++ = (off + len == rawLen) ? 1 : 0;
+		*q++ = len & 0xFF;
+		*q++ = len >> 8;
+		*q++ = ~len & 0xFF;
+		*q++ = (~len >> 8) & 0xFF;
+		memcpy(q, raw + off, len);
+		q += len;
+		for (uint32_t i = 0; i < len; i++)
+		{
+			a = (a + raw[off + i]) % 65521;
+			b = (b + a) % 65521;
+		}
+	}
+	putBE32(q, (b << 16) | a);
+	writeChunk(f, "IDAT", z, zLen);
+	writeChunk(f, "IEND", NULL, 0);
+	delete[] z;
+	delete[] raw;
+	fclose(f);
+	return true;
+}
+
+void ILIEmulator::printCounters(FILE *f) const
+{
+	fprintf(f, "bytes=%u cmd=%u data=%u pixelBytes=%u readBytes=%u pixelsWritten=%u pixelsRead=%u windowSets=%u ramWrites=%u csToggles=%u\n",
+		_counters.bytes, _counters.commandBytes, _counters.dataBytes, _counters.pixelBytes, _counters.readBytes,
+		_counters.pixelsWritten, _counters.pixelsRead, _counters.windowSets, _counters.ramWrites, _counters.csToggles);
+}
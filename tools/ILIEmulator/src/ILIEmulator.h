@@ -0,0 +1,115 @@
+/*
+ILIEmulator.h - host-side ILI9341 command stream emulator
+
+Decodes the byte stream the ILI9341_due driver sends over SPI into an
+in-memory 240x320 GRAM, so the driver can be exercised on a normal PC.
+
+Code: https://github.com/marekburiak/ILI9341_due
+Documentation: http://marekburiak.github.io/ILI9341_due/
+
+Copyright (c) 2015  Marek Buriak
+
+*/
+
+#ifndef _ILIEmulatorH_
+#define _ILIEmulatorH_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define ILI_EMU_WIDTH 240
+#define ILI_EMU_HEIGHT 320
+#define ILI_EMU_LINES_PER_FRAME 324	// 320 lines + front and back porch
+#define ILI_EMU_BYTES_PER_LINE 64	// GETSCAN reports the refresh advancing one line every this many bytes
+
+typedef struct
+{
+	uint32_t bytes;			// all bytes clocked on the bus
+	uint32_t commandBytes;	// bytes sent with DC low
+	uint32_t dataBytes;		// bytes sent with DC high (parameters + pixels)
+	uint32_t pixelBytes;	// bytes written after RAMWR
+	uint32_t readBytes;		// bytes clocked in after a read command
+	uint32_t pixelsWritten;
+	uint32_t pixelsRead;
+	uint32_t windowSets;	// CASET + PASET commands
+	uint32_t ramWrites;		// RAMWR commands
+	uint32_t csToggles;		// CS falling edges
+	uint32_t commands[256];	// count per command code
+} iliEmuCounters;
+
+class ILIEmulator
+{
+public:
+	ILIEmulator();
+
+	// Connects the emulator to the host SPI/pin layer.
+	// dcPin and csPin must be the pins passed to the ILI9341_due constructor.
+	void attach(uint8_t csPin, uint8_t dcPin);
+
+	void reset();
+	void resetCounters();
+	const iliEmuCounters& counters() const { return _counters; }
+
+	// Clocks one byte in and returns the byte the controller shifts out.
+	uint8_t transfer(uint8_t b);
+	// Called by the host layer when the level of a pin changes.
+	void pinChanged(uint8_t pin);
+
+	// GRAM access in panel coordinates (rotation 0, as seen on the glass).
+	uint16_t pixel565(uint16_t x, uint16_t y) const;
+	uint32_t pixelRGB(uint16_t x, uint16_t y) const;	// 0x00RRGGBB
+
+	// Pixel as currently shown, with vertical scrolling applied.
+	uint32_t displayedRGB(uint16_t x, uint16_t y) const;
+
+	bool savePPM(const char *filename) const;
+	bool savePNG(const char *filename) const;
+	void printCounters(FILE *f) const;
+
+	uint8_t madctl() const { return _madctl; }
+	uint8_t pixelFormat() const { return _pixfmt; }
+	uint16_t scrollStart() const { return _vsp; }
+	bool isDisplayOn() const { return _displayOn; }
+	bool isSleeping() const { return _sleep; }
+	bool isTearingEffectOn() const { return _teOn; }
+
+private:
+	void command(uint8_t c);
+	void data(uint8_t d);
+	uint8_t readByte();
+	void writePixel(uint16_t color);
+	void readPixelBytes();
+	void advance();
+	void mapAddress(uint16_t col, uint16_t page, uint16_t *px, uint16_t *py) const;
+	void displayedRow(uint16_t y, uint16_t *memRow) const;
+
+	uint8_t _cs, _dc;
+	bool _csLow;
+
+	uint32_t _gram[ILI_EMU_HEIGHT][ILI_EMU_WIDTH];	// 18-bit colour stored as 0x00RRGGBB (6 bits each, left aligned)
+
+	uint8_t _cmd;
+	uint8_t _params[16];
+	uint8_t _paramCount;
+	uint8_t _readIndex;
+	uint8_t _readIndexOverride;
+	uint8_t _resp[8];
+	uint8_t _respLen;
+
+	uint16_t _colStart, _colEnd, _pageStart, _pageEnd;
+	uint16_t _col, _page;
+	uint8_t _pixHi;
+	bool _pixHalf;
+	uint8_t _readBuf[3];
+	uint8_t _readBufPos;
+	bool _readDummyDone;
+
+	uint8_t _madctl, _pixfmt;
+	uint16_t _tfa, _vsa, _bfa, _vsp;
+	bool _sleep, _displayOn, _inverted, _idle, _teOn;
+	uint8_t _teMode;
+
+	iliEmuCounters _counters;
+};
+
+#endif
@@ -0,0 +1,183 @@
+/*
+Arduino.h - the part of the Arduino Due core ILI9341_due uses, for building it on a PC
+
+The SPI peripheral and the pins are replaced by g_hostSpiTransfer and g_hostPins,
+ILIEmulator connects itself to them.
+*/
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// output register of a pin, reports every change to g_hostPinChanged
+struct HostPinRegister {
+	uint32_t value;
+	void operator|=(uint32_t mask) volatile;
+	void operator&=(uint32_t mask) volatile;
+};
+typedef HostPinRegister RwReg;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 3
+#define FALLING 2
+#define CHANGE 1
+#define DEC 10
+#define HEX 16
+#define PI 3.1415926535897932384626433832795
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define F_CPU 84000000L
+#ifndef min
+#define min(a,b) ((a)<(b)?(a):(b))
+#endif
+#ifndef max
+#define max(a,b) ((a)>(b)?(a):(b))
+#endif
+#define lowByte(w) ((uint8_t) ((w) & 0xff))
+#define highByte(w) ((uint8_t) ((w) >> 8))
+#define makeWord(h, l) ((uint16_t)(((h) << 8) | (l)))
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define digitalPinToInterrupt(p) (p)
+
+extern volatile RwReg g_hostPins[256];
+extern void (*g_hostPinChanged)(uint8_t pin);
+#define digitalPinToPort(p) (p)
+#define portOutputRegister(port) (&g_hostPins[(port)])
+#define digitalPinToBitMask(p) (1u)
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+uint32_t millis();
+uint32_t micros();
+void attachInterrupt(uint8_t irq, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t irq);
+void noInterrupts();
+void interrupts();
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+class String {
+public:
+	String(const char *s = "") { _s = s ? strdup(s) : strdup(""); }
+	String(const String &o) { _s = strdup(o._s); }
+	~String() { free(_s); }
+	String &operator=(const String &o) { if (this != &o) { free(_s); _s = strdup(o._s); } return *this; }
+	unsigned int length() const { return (unsigned int)strlen(_s); }
+	char operator[](unsigned int i) const { return _s[i]; }
+	const char *c_str() const { return _s; }
+private:
+	char *_s;
+};
+
+class Print;
+class Printable {
+public:
+	virtual size_t printTo(Print &p) const = 0;
+	virtual ~Printable() {}
+};
+
+class Print {
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t) = 0;
+	virtual size_t write(const uint8_t *buf, size_t n) { size_t r = 0; while (n--) r += write(*buf++); return r; }
+	size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+	size_t print(const __FlashStringHelper *s) { return print((const char *)s); }
+	size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+	size_t print(const char s[]) { return write(s); }
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(unsigned char n, int b = DEC) { return print((unsigned long)n, b); }
+	size_t print(int n, int b = DEC) { return print((long)n, b); }
+	size_t print(unsigned int n, int b = DEC) { return print((unsigned long)n, b); }
+	size_t print(long n, int b = DEC) { char t[40]; if (b == 16) snprintf(t, sizeof t, "%lX", n); else snprintf(t, sizeof t, "%ld", n); return write(t); }
+	size_t print(unsigned long n, int b = DEC) { char t[40]; if (b == 16) snprintf(t, sizeof t, "%lX", n); else snprintf(t, sizeof t, "%lu", n); return write(t); }
+	size_t print(double d, int p = 2) { char t[64]; snprintf(t, sizeof t, "%.*f", p, d); return write(t); }
+	size_t print(const Printable &x) { return x.printTo(*this); }
+	size_t println(const __FlashStringHelper *s) { return print(s) + println(); }
+	size_t println(const String &s) { return print(s) + println(); }
+	size_t println(const char s[]) { return print(s) + println(); }
+	size_t println(char c) { return print(c) + println(); }
+	size_t println(unsigned char n, int b = DEC) { return print(n, b) + println(); }
+	size_t println(int n, int b = DEC) { return print(n, b) + println(); }
+	size_t println(unsigned int n, int b = DEC) { return print(n, b) + println(); }
+	size_t println(long n, int b = DEC) { return print(n, b) + println(); }
+	size_t println(unsigned long n, int b = DEC) { return print(n, b) + println(); }
+	size_t println(double d, int p = 2) { return print(d, p) + println(); }
+	size_t println(const Printable &x) { return print(x) + println(); }
+	size_t println(void) { return write("\r\n"); }
+};
+
+class Stream : public Print {
+public:
+	virtual int available() { return 0; }
+	virtual int read() { return -1; }
+};
+
+class HostSerial : public Stream {
+public:
+	void begin(unsigned long) {}
+	size_t write(uint8_t c) { fputc(c, stderr); return 1; }
+	using Print::write;
+	operator bool() { return true; }
+};
+extern HostSerial Serial;
+
+// SAM3X SPI peripheral, just enough for SPI_MODE_NORMAL
+#define SPI_SR_RDRF (1u << 0)
+#define SPI_SR_TDRE (1u << 1)
+#define SPI_SR_TXEMPTY (1u << 9)
+#define SPI_TDR_LASTXFER (1u << 24)
+#define SPI_PCS(x) ((0xFu & ~(1u << (x))) << 16)
+#define BOARD_SPI_DEFAULT_SS 78
+#define BOARD_PIN_TO_SPI_CHANNEL(x) ((x) == 4 ? 1 : ((x) == 52 ? 2 : 0))
+
+struct HostSpiTdr {
+	HostSpiTdr &operator=(uint32_t d);
+};
+struct HostSpiRdr {
+	operator uint32_t() const;
+};
+struct Spi {
+	uint32_t SPI_CR;
+	uint32_t SPI_MR;
+	uint32_t SPI_SR;
+	HostSpiTdr SPI_TDR;
+	HostSpiRdr SPI_RDR;
+	uint32_t SPI_CSR[4];
+};
+extern Spi g_hostSpi0;
+#define SPI0 (&g_hostSpi0)
+
+// cycle counter used by ILI_USE_STATS, it does not count on the PC
+struct HostCoreDebug { uint32_t DEMCR; };
+struct HostDWT { uint32_t CTRL; uint32_t CYCCNT; };
+extern HostCoreDebug g_hostCoreDebug;
+extern HostDWT g_hostDWT;
+#define CoreDebug (&g_hostCoreDebug)
+#define DWT (&g_hostDWT)
+#define CoreDebug_DEMCR_TRCENA_Msk (1u << 24)
+#define DWT_CTRL_CYCCNTENA_Msk 1u
+
+// bus hook, set by the emulator
+extern uint8_t (*g_hostSpiTransfer)(uint8_t b);
+#endif
@@ -0,0 +1,10 @@
+// the library's configuration, with the SPI mode the host layer emulates
+#include "../../../../ILI9341_due_config.h"
+#undef ILI9341_SPI_MODE_EXTENDED
+#undef ILI9341_SPI_MODE_DMA
+#define ILI9341_SPI_MODE_NORMAL
+
+// the benchmark estimates the time on the devices from the library's counters
+#ifndef ILI_USE_STATS
+#define ILI_USE_STATS
+#endif
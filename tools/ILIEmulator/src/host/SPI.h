@@ -0,0 +1,35 @@
+/*
+SPI.h - SPI library of the Arduino Due for building ILI9341_due on a PC, transfers go to g_hostSpiTransfer
+*/
+
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+#include "Arduino.h"
+#define MSBFIRST 1
+#define SPI_MODE0 0
+#define SPI_CLOCK_DIV2 0x04
+#define SPI_CLOCK_DIV4 0x00
+#define SPI_CLOCK_DIV8 0x05
+#define SPI_CLOCK_DIV16 0x01
+#define SPI_CLOCK_DIV32 0x06
+#define SPI_CLOCK_DIV64 0x02
+#define SPI_CLOCK_DIV128 0x03
+class SPISettings {
+public:
+	SPISettings() {}
+	SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+class SPIClass {
+public:
+	void begin() {}
+	void end() {}
+	uint8_t transfer(uint8_t b) { return g_hostSpiTransfer(b); }
+	void setClockDivider(uint8_t d) { clockDivider = d; }
+	void setBitOrder(uint8_t) {}
+	void setDataMode(uint8_t) {}
+	void beginTransaction(SPISettings) {}
+	void endTransaction() {}
+	uint8_t clockDivider;	// last divider set, the PC does not care about the clock
+};
+extern SPIClass SPI;
+#endif
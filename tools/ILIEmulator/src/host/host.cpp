@@ -0,0 +1,81 @@
+/*
+host.cpp - Arduino core functions for building ILI9341_due on a PC
+*/
+
+#include <chrono>
+#include "Arduino.h"
+#include "SPI.h"
+
+volatile RwReg g_hostPins[256];
+HostSerial Serial;
+SPIClass SPI;
+Spi g_hostSpi0 = { 0, 0, 0xFFFFFFFFu, {}, {}, { 0, 0, 0, 0 } };
+HostCoreDebug g_hostCoreDebug;
+HostDWT g_hostDWT;
+
+static uint8_t nullTransfer(uint8_t) { return 0xFF; }
+static void nullPinChanged(uint8_t) {}
+uint8_t(*g_hostSpiTransfer)(uint8_t b) = nullTransfer;
+void(*g_hostPinChanged)(uint8_t pin) = nullPinChanged;
+
+void HostPinRegister::operator|=(uint32_t mask) volatile
+{
+	value |= mask;
+	g_hostPinChanged((uint8_t)(this - g_hostPins));
+}
+
+void HostPinRegister::operator&=(uint32_t mask) volatile
+{
+	value &= mask;
+	g_hostPinChanged((uint8_t)(this - g_hostPins));
+}
+
+// SPI_MODE_NORMAL writes the SAM3X SPI registers directly, 16 bit transfers are enabled in SPI_CSR
+static uint32_t s_received;
+
+HostSpiTdr &HostSpiTdr::operator=(uint32_t d)
+{
+	s_received = 0;
+	if (g_hostSpi0.SPI_CSR[0] & 0x80)
+		s_received = (uint32_t)g_hostSpiTransfer((uint8_t)(d >> 8)) << 8;
+	s_received |= g_hostSpiTransfer((uint8_t)d);
+	return *this;
+}
+
+HostSpiRdr::operator uint32_t() const
+{
+	return s_received;
+}
+
+static uint32_t now(bool micro)
+{
+	const std::chrono::steady_clock::duration t = std::chrono::steady_clock::now().time_since_epoch();
+	if (micro)
+		return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(t).count();
+	return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(t).count();
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	if (val)
+		g_hostPins[pin] |= 1;
+	else
+		g_hostPins[pin] &= ~1u;
+}
+
+int digitalRead(uint8_t pin)
+{
+	return g_hostPins[pin].value & 1;
+}
+
+// nothing happens in real time on the PC, delays return immediately
+void delay(uint32_t) {}
+void delayMicroseconds(uint32_t) {}
+uint32_t millis() { return now(false); }
+uint32_t micros() { return now(true); }
+void attachInterrupt(uint8_t, void(*)(void), int) {}
+void detachInterrupt(uint8_t) {}
+void noInterrupts() {}
+void interrupts() {}
@@ -0,0 +1,427 @@
+/*
+iliBenchmark.cpp - runs the graphicstestWithStats scenes against the emulator
+
+For every scene it records the bytes on the bus, the commands, the address window
+changes (CASET/PASET), the time the traffic would take on a Due with DMA at SPI clock
+divider 2 and 4 and on an AVR at SPI_CLOCK_DIV2 (ILI9341_due::estimateMicros) and the
+CPU time, writes them to a results file and compares them with a thresholds file.
+Exits with 1 when a scene goes over its threshold.
+
+Usage: iliBenchmark [-o results.txt] [-t thresholds.txt] [-u] [-r repeats]
+  -o  where to write the results (default: benchmark_results.txt)
+  -t  thresholds to check the results against
+  -u  write the thresholds file from this run instead of checking it
+  -r  how many times each scene is run for the CPU time, the fastest run is kept (default: 5)
+
+Both files have one line per scene with tab separated columns
+  scene  bytes  commands  windowSets  dueDma2Micros  dueDma4Micros  avr2Micros  cpuMicros
+lines starting with # are comments, - in a thresholds column means no limit.
+The bus counters and estimates do not depend on the machine, the CPU time does, so the
+thresholds written with -u leave it 50% headroom and are meant for the machine they
+were made on.
+*/
+
+#include <string.h>
+#include <time.h>
+#include "ILI9341_due.h"
+#include "ILIEmulator.h"
+#include "fonts/SystemFont5x7.h"
+#include "../../../examples/arrayTftBitmap/Alert.h"
+#include "../../../examples/arrayTftBitmap/Close.h"
+#include "../../../examples/arrayTftBitmap/Info.h"
+
+#define TFT_CS 10
+#define TFT_DC 9
+#define TFT_RST 8
+
+#define CPU_HEADROOM_PERCENT 50
+
+ILI9341_due tft(TFT_CS, TFT_DC, TFT_RST);
+ILIEmulator emulator;
+
+typedef struct
+{
+	const char *name;
+	void(*prepare)();	// not measured (clears the screen like the untimed fillScreen calls in graphicstestWithStats)
+	void(*run)();
+} benchScene;
+
+enum { colBytes, colCommands, colWindowSets, colDueDma2, colDueDma4, colAvr2, colCpu, columnCount };
+static const char *columnNames[columnCount] = {
+	"bytes", "commands", "windowSets", "dueDma2Micros", "dueDma4Micros", "avr2Micros", "cpuMicros"
+};
+
+typedef struct
+{
+	uint32_t values[columnCount];
+} benchResult;
+
+static void clearBlack()
+{
+	tft.fillScreen(ILI9341_BLACK);
+}
+
+static void sceneFillScreen()
+{
+	tft.fillScreen(ILI9341_BLACK);
+	tft.fillScreen(ILI9341_RED);
+	tft.fillScreen(ILI9341_GREEN);
+	tft.fillScreen(ILI9341_BLUE);
+	tft.fillScreen(ILI9341_BLACK);
+}
+
+static void sceneText()
+{
+	tft.setFont(SystemFont5x7);
+	tft.cursorTo(0, 0);
+	tft.setTextColor(ILI9341_WHITE, ILI9341_BLACK);  tft.setTextScale(1);
+	tft.println(F("Hello World!"));
+	tft.setTextColor(ILI9341_YELLOW); tft.setTextScale(2);
+	tft.println(1234.56);
+	tft.setTextColor(ILI9341_RED);    tft.setTextScale(3);
+	tft.println(0xDEADBEEF, HEX);
+	tft.println();
+	tft.setTextColor(ILI9341_GREEN);
+	tft.setTextScale(5);
+	tft.println(F("Groop"));
+	tft.setTextScale(2);
+	tft.println(F("I implore thee,"));
+	tft.setTextScale(1);
+	tft.println(F("my foonting turlingdromes."));
+	tft.println(F("And hooptiously drangle me"));
+	tft.println(F("with crinkly bindlewurdles,"));
+	tft.println(F("Or I will rend thee"));
+	tft.println(F("in the gobberwarts"));
+	tft.println(F("with my blurglecruncheon,"));
+	tft.println(F("see if I don't!"));
+}
+
+static void sceneLines()
+{
+	int x1, y1, x2, y2, w = tft.width(), h = tft.height();
+
+	for (uint8_t corner = 0; corner < 4; corner++)
+	{
+		x1 = (corner & 1) ? w - 1 : 0;
+		y1 = (corner & 2) ? h - 1 : 0;
+		y2 = h - 1 - y1;
+		for (x2 = 0; x2 < w; x2 += 6) tft.drawLine(x1, y1, x2, y2, ILI9341_CYAN);
+		x2 = w - 1 - x1;
+		for (y2 = 0; y2 < h; y2 += 6) tft.drawLine(x1, y1, x2, y2, ILI9341_CYAN);
+	}
+}
+
+static void sceneFastLines()
+{
+	int x, y, w = tft.width(), h = tft.height();
+
+	for (y = 0; y < h; y += 5) tft.drawFastHLine(0, y, w, ILI9341_RED);
+	for (x = 0; x < w; x += 5) tft.drawFastVLine(x, 0, h, ILI9341_BLUE);
+}
+
+static void sceneRects()
+{
+	int n = min(tft.width(), tft.height()), cx = tft.width() / 2, cy = tft.height() / 2;
+
+	for (int i = 2; i < n; i += 6)
+		tft.drawRect(cx - i / 2, cy - i / 2, i, i, ILI9341_GREEN);
+}
+
+static void sceneFilledRects()
+{
+	int n = min(tft.width(), tft.height()), cx = tft.width() / 2 - 1, cy = tft.height() / 2 - 1;
+
+	for (int i = n; i > 0; i -= 6)
+		tft.fillRect(cx - i / 2, cy - i / 2, i, i, ILI9341_YELLOW);
+}
+
+static void sceneFilledCircles()
+{
+	const uint8_t radius = 10;
+	int w = tft.width(), h = tft.height();
+
+	for (int x = radius; x < w; x += radius * 2)
+		for (int y = radius; y < h; y += radius * 2)
+			tft.fillCircle(x, y, radius, ILI9341_MAGENTA);
+}
+
+static void sceneCircles()
+{
+	const uint8_t radius = 10;
+	int w = tft.width() + radius, h = tft.height() + radius;
+
+	for (int x = 0; x < w; x += radius * 2)
+		for (int y = 0; y < h; y += radius * 2)
+			tft.drawCircle(x, y, radius, ILI9341_WHITE);
+}
+
+static void sceneTriangles()
+{
+	int cx = tft.width() / 2 - 1, cy = tft.height() / 2 - 1, n = min(cx, cy);
+
+	for (int i = 0; i < n; i += 5)
+		tft.drawTriangle(cx, cy - i, cx - i, cy + i, cx + i, cy + i, tft.color565(0, 0, i));
+}
+
+static void sceneFilledTriangles()
+{
+	int cx = tft.width() / 2 - 1, cy = tft.height() / 2 - 1;
+
+	for (int i = min(cx, cy); i > 10; i -= 5)
+		tft.fillTriangle(cx, cy - i, cx - i, cy + i, cx + i, cy + i, tft.color565(0, i, i));
+}
+
+static void sceneRoundRects()
+{
+	int w = min(tft.width(), tft.height()), cx = tft.width() / 2 - 1, cy = tft.height() / 2 - 1;
+
+	for (int i = 0; i < w; i += 6)
+		tft.drawRoundRect(cx - i / 2, cy - i / 2, i, i, i / 8, tft.color565(i, 0, 0));
+}
+
+static void sceneFilledRoundRects()
+{
+	int cx = tft.width() / 2 - 1, cy = tft.height() / 2 - 1;
+
+	for (int i = min(tft.width(), tft.height()); i > 20; i -= 6)
+		tft.fillRoundRect(cx - i / 2, cy - i / 2, i, i, i / 8, tft.color565(0, i, 0));
+}
+
+static void sceneArcs()
+{
+	const uint16_t x = tft.width() / 2, y = tft.height() / 2;
+
+	// the clock from the arcs example
+	tft.fillArc(x, y, 102, 11, 0, 225, ILI9341_LIGHTGREY);
+	tft.fillArc(x, y, 113, 8, 0, 36, ILI9341_DARKGRAY);
+	tft.fillArc(x, y, 120, 5, 0, 360, ILI9341_DARKGRAY);
+	for (int d = 0; d < 360; d += 15)
+		tft.fillArc(x, y, 60, 10, d, d + 10, ILI9341_RED);
+}
+
+static void sceneImages()
+{
+	for (uint16_t y = 0; y + 32 <= tft.height(); y += 32)
+	{
+		for (uint16_t x = 0; x + 32 <= tft.width(); x += 96)
+		{
+			tft.drawImage(alert, x, y, alertWidth, alertHeight);
+			tft.drawImage(close, x + 32, y, closeWidth, closeHeight);
+			tft.drawImage(info, x + 64, y, infoWidth, infoHeight);
+		}
+	}
+}
+
+static const benchScene scenes[] = {
+	{ "fillScreen", 0, sceneFillScreen },
+	{ "text", clearBlack, sceneText },
+	{ "lines", clearBlack, sceneLines },
+	{ "fastLines", clearBlack, sceneFastLines },
+	{ "rects", clearBlack, sceneRects },
+	{ "filledRects", clearBlack, sceneFilledRects },
+	{ "filledCircles", clearBlack, sceneFilledCircles },
+	{ "circles", 0, sceneCircles },
+	{ "triangles", clearBlack, sceneTriangles },
+	{ "filledTriangles", clearBlack, sceneFilledTriangles },
+	{ "roundRects", clearBlack, sceneRoundRects },
+	{ "filledRoundRects", clearBlack, sceneFilledRoundRects },
+	{ "arcs", clearBlack, sceneArcs },
+	{ "images", clearBlack, sceneImages },
+};
+static const int sceneCount = sizeof(scenes) / sizeof(scenes[0]);
+
+static uint64_t cpuMicros()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void runScene(const benchScene &scene, int repeats, benchResult *result)
+{
+	static const iliBusTiming dueDma2 = ILI9341_due::getBusTiming(iliBusDueDMA, 2, 16);
+	static const iliBusTiming dueDma4 = ILI9341_due::getBusTiming(iliBusDueDMA, 4, 16);
+	static const iliBusTiming avr2 = ILI9341_due::getBusTiming(iliBusAVR, 2, 4);
+
+	for (int r = 0; r < repeats; r++)
+	{
+		if (scene.prepare)
+			scene.prepare();
+		emulator.resetCounters();
+		tft.resetStats();
+		const uint64_t start = cpuMicros();
+		scene.run();
+		const uint32_t elapsed = (uint32_t)(cpuMicros() - start);
+
+		// the bus traffic is the same every run, the CPU time is the fastest run
+		const iliEmuCounters &c = emulator.counters();
+		const iliStats stats = tft.getTotalStats();
+		result->values[colBytes] = c.bytes;
+		result->values[colCommands] = c.commandBytes;
+		result->values[colWindowSets] = c.windowSets;
+		result->values[colDueDma2] = ILI9341_due::estimateMicros(stats, dueDma2);
+		result->values[colDueDma4] = ILI9341_due::estimateMicros(stats, dueDma4);
+		result->values[colAvr2] = ILI9341_due::estimateMicros(stats, avr2);
+		if (r == 0 || elapsed < result->values[colCpu])
+			result->values[colCpu] = elapsed;
+	}
+}
+
+static bool writeResults(const char *filename, const benchResult *results, bool thresholds)
+{
+	FILE *f = fopen(filename, "w");
+	if (!f)
+		return false;
+	fprintf(f, thresholds ? "# iliBenchmark thresholds, regenerate with iliBenchmark -u -t <file>\n" : "# iliBenchmark results\n");
+	fprintf(f, "# scene");
+	for (int c = 0; c < columnCount; c++)
+		fprintf(f, "\t%s", columnNames[c]);
+	fprintf(f, "\n");
+	for (int i = 0; i < sceneCount; i++)
+	{
+		fprintf(f, "%s", scenes[i].name);
+		for (int c = 0; c < columnCount; c++)
+		{
+			uint32_t value = results[i].values[c];
+			if (thresholds && c == colCpu)
+				value += value * CPU_HEADROOM_PERCENT / 100 + 1;
+			fprintf(f, "\t%u", value);
+		}
+		fprintf(f, "\n");
+	}
+	return fclose(f) == 0;
+}
+
+// returns true if the value is over the limit, "-" is no limit
+static bool overLimit(const char *scene, const char *column, uint32_t value, const char *limit)
+{
+	if (strcmp(limit, "-") == 0)
+		return false;
+	const uint32_t max = (uint32_t)strtoul(limit, 0, 10);
+	if (value <= max)
+		return false;
+	printf("FAIL %s: %s %u > %u\n", scene, column, value, max);
+	return true;
+}
+
+// returns the number of values over their thresholds, -1 if the file cannot be read
+static int checkThresholds(const char *filename, const benchResult *results)
+{
+	FILE *f = fopen(filename, "r");
+	if (!f)
+		return -1;
+
+	int failures = 0;
+	char line[256];
+	while (fgets(line, sizeof(line), f))
+	{
+		const char *name = strtok(line, " \t\r\n");
+		if (!name || name[0] == '#')
+			continue;
+		const char *limits[columnCount];
+		int columns = 0;
+		while (columns < columnCount && (limits[columns] = strtok(0, " \t\r\n")) != 0)
+			columns++;
+		if (columns != columnCount)
+		{
+			printf("WARN %s in %s does not have %d columns\n", name, filename, columnCount);
+			continue;
+		}
+
+		int i = 0;
+		while (i < sceneCount && strcmp(scenes[i].name, name) != 0)
+			i++;
+		if (i == sceneCount)
+		{
+			printf("WARN unknown scene %s in %s\n", name, filename);
+			continue;
+		}
+		for (int c = 0; c < columnCount; c++)
+			failures += overLimit(name, columnNames[c], results[i].values[c], limits[c]);
+	}
+	fclose(f);
+	return failures;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *resultsFile = "benchmark_results.txt";
+	const char *thresholdsFile = 0;
+	bool update = false;
+	int repeats = 5;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			resultsFile = argv[++i];
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			thresholdsFile = argv[++i];
+		else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+			repeats = max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "-u") == 0)
+			update = true;
+		else
+		{
+			fprintf(stderr, "Usage: iliBenchmark [-o results.txt] [-t thresholds.txt] [-u] [-r repeats]\n");
+			return 2;
+		}
+	}
+	if (update && !thresholdsFile)
+	{
+		fprintf(stderr, "-u needs the thresholds file (-t)\n");
+		return 2;
+	}
+
+	emulator.attach(TFT_CS, TFT_DC);
+	tft.begin();
+	tft.setRotation(iliRotation0);
+
+	benchResult results[sceneCount];
+	printf("%-18s", "scene");
+	for (int c = 0; c < columnCount; c++)
+		printf(" %14s", columnNames[c]);
+	printf("\n");
+	for (int i = 0; i < sceneCount; i++)
+	{
+		runScene(scenes[i], repeats, &results[i]);
+		printf("%-18s", scenes[i].name);
+		for (int c = 0; c < columnCount; c++)
+			printf(" %14u", results[i].values[c]);
+		printf("\n");
+	}
+
+	if (!writeResults(resultsFile, results, false))
+	{
+		fprintf(stderr, "Could not write %s\n", resultsFile);
+		return 2;
+	}
+	printf("Results saved to %s\n", resultsFile);
+
+	if (!thresholdsFile)
+		return 0;
+
+	if (update)
+	{
+		if (!writeResults(thresholdsFile, results, true))
+		{
+			fprintf(stderr, "Could not write %s\n", thresholdsFile);
+			return 2;
+		}
+		printf("Thresholds saved to %s\n", thresholdsFile);
+		return 0;
+	}
+
+	const int failures = checkThresholds(thresholdsFile, results);
+	if (failures < 0)
+	{
+		fprintf(stderr, "Could not read %s\n", thresholdsFile);
+		return 2;
+	}
+	if (failures)
+	{
+		printf("%d value(s) over the thresholds in %s\n", failures, thresholdsFile);
+		return 1;
+	}
+	printf("All scenes within the thresholds in %s\n", thresholdsFile);
+	return 0;
+}
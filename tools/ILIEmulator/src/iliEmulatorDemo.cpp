@@ -0,0 +1,80 @@
+/*
+iliEmulatorDemo.cpp - draws a screen with ILI9341_due running on the emulator
+
+Prints what each drawing call sent over the bus and saves the screen.
+Usage: iliEmulatorDemo [screen.png|screen.ppm]
+*/
+
+#include <string.h>
+#include "ILI9341_due.h"
+#include "ILIEmulator.h"
+#include "fonts/Arial_bold_14.h"
+#include "../../../examples/arrayTftBitmap/Alert.h"
+
+#define TFT_CS 10
+#define TFT_DC 9
+#define TFT_RST 8
+
+ILI9341_due tft(TFT_CS, TFT_DC, TFT_RST);
+ILIEmulator emulator;
+
+static void report(const char *name)
+{
+	printf("%-22s ", name);
+	emulator.printCounters(stdout);
+	emulator.resetCounters();
+}
+
+int main(int argc, char *argv[])
+{
+	const char *filename = argc > 1 ? argv[1] : "screen.png";
+
+	emulator.attach(TFT_CS, TFT_DC);
+	tft.begin();
+	report("begin");
+
+	tft.setRotation(iliRotation270);
+	report("setRotation");
+
+	tft.fillScreen(ILI9341_NAVY);
+	report("fillScreen");
+
+	tft.fillRect(10, 10, 100, 60, ILI9341_DARKGREEN);
+	report("fillRect");
+
+	tft.drawRect(10, 10, 100, 60, ILI9341_WHITE);
+	report("drawRect");
+
+	tft.drawLine(0, 239, 319, 0, ILI9341_YELLOW);
+	report("drawLine");
+
+	tft.fillCircle(200, 60, 40, ILI9341_RED);
+	report("fillCircle");
+
+	tft.drawCircle(200, 60, 45, ILI9341_WHITE);
+	report("drawCircle");
+
+	tft.fillTriangle(20, 220, 80, 120, 140, 220, ILI9341_ORANGE);
+	report("fillTriangle");
+
+	tft.fillRoundRect(170, 130, 120, 50, 10, ILI9341_PURPLE);
+	report("fillRoundRect");
+
+	tft.drawImage(alert, 260, 190, alertWidth, alertHeight);
+	report("drawImage");
+
+	tft.setFont(Arial_bold_14);
+	tft.setTextColor(ILI9341_WHITE, ILI9341_NAVY);
+	tft.printAt("ILI9341_due", 160, 200);
+	report("printAt");
+
+	const size_t len = strlen(filename);
+	const bool ppm = len > 4 && strcmp(filename + len - 4, ".ppm") == 0;
+	if (!(ppm ? emulator.savePPM(filename) : emulator.savePNG(filename)))
+	{
+		fprintf(stderr, "Could not write %s\n", filename);
+		return 1;
+	}
+	printf("Screen saved to %s\n", filename);
+	return 0;
+}
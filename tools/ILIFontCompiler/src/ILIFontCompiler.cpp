@@ -0,0 +1,556 @@
+/*
+ILIFontCompiler.cpp - converts BDF fonts and fonts of the GLCD format into extended fonts for ILI9341_due
+
+An extended font has a table with the offset of each glyph, stores the glyphs row by row
+and can hold several ranges of codes, see GTEXT_XFONT_VERSION in ILI9341_due.h.
+It is selected with setFont like any other font.
+
+Usage: ILIFontCompiler [-e bitmap|rle|auto] [-r ranges] [-n name] [-w column width] input.bdf|input.h output.h
+  -e  glyph encoding, bitmap, rle (runs of pixels, identical rows stored once) or auto, the smaller one (default)
+  -r  codes to take from the input, e.g. 32-126,176 (default: all of them up to 255)
+  -n  name of the array (default: the name of the output file)
+  -w  width of a column for cursorTo and setTextArea with columns (default: the widest glyph)
+
+Code: https://github.com/marekburiak/ILI9341_due
+Documentation: http://marekburiak.github.io/ILI9341_due/
+
+Copyright (c) 2015  Marek Buriak
+
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// the same layout as in ILI9341_due.h
+#define GTEXT_FONT_FIXED_WIDTH 2
+#define GTEXT_FONT_HEIGHT 3
+#define GTEXT_FONT_FIRST_CHAR 4
+#define GTEXT_FONT_CHAR_COUNT 5
+#define GTEXT_FONT_WIDTH_TABLE 6
+#define XFONT_VERSION 1
+#define XFONT_HEADER_SIZE 10
+#define XFONT_MAX_OFFSET 0xFFFFFF
+enum { glyphBitmap, glyphRLE, glyphAuto };
+
+struct Glyph
+{
+	uint16_t w = 0;
+	std::vector<uint8_t> pixels;	// w * font height, 1 = set
+};
+
+struct Font
+{
+	uint16_t height = 0;
+	std::map<int, Glyph> glyphs;	// by code
+};
+
+static bool readText(const std::string &filename, std::string &text)
+{
+	std::ifstream in(filename, std::ios::binary);
+	if (!in)
+		return false;
+	std::stringstream ss;
+	ss << in.rdbuf();
+	text = ss.str();
+	return true;
+}
+
+// Reads a BDF font. The glyphs are placed into cells of FONT_ASCENT + FONT_DESCENT rows and are
+// as wide as their advance (DWIDTH) or their bitmap if it reaches further.
+static bool loadBDF(const std::string &text, Font &font)
+{
+	std::istringstream in(text);
+	std::string line;
+	int ascent = -1, descent = -1;
+	int boxH = 0, boxY = 0;
+	int code = -1, advance = 0, w = 0, h = 0, xo = 0, yo = 0;
+	bool inBitmap = false;
+	std::vector<std::string> rows;
+
+	while (std::getline(in, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		std::istringstream ls(line);
+		std::string key;
+		ls >> key;
+		if (inBitmap)
+		{
+			if (key != "ENDCHAR")
+			{
+				rows.push_back(key);
+				continue;
+			}
+			inBitmap = false;
+			if (ascent < 0)
+				ascent = boxH + boxY;
+			if (descent < 0)
+				descent = -boxY;
+			font.height = ascent + descent;
+			if (code < 0 || code > 255)
+				continue;	// a glyph without a code or out of the range of char
+
+			const int shift = xo < 0 ? -xo : 0;	// glyphs reaching left of the origin are moved right
+			Glyph glyph;
+			glyph.w = std::max(advance + shift, xo + shift + w);
+			glyph.pixels.assign((size_t)glyph.w * font.height, 0);
+			const int top = ascent - (yo + h);
+			for (int r = 0; r < h && r < (int)rows.size(); r++)
+			{
+				const int y = top + r;
+				if (y < 0 || y >= font.height)
+					continue;
+				for (int c = 0; c < w; c++)
+				{
+					const size_t digit = c / 4;
+					if (digit >= rows[r].size())
+						break;
+					const int nibble = (int)strtol(rows[r].substr(digit, 1).c_str(), NULL, 16);
+					if (nibble & (8 >> (c % 4)))
+						glyph.pixels[(size_t)y * glyph.w + xo + shift + c] = 1;
+				}
+			}
+			font.glyphs[code] = glyph;
+		}
+		else if (key == "FONTBOUNDINGBOX")
+		{
+			int boxW, boxX;
+			ls >> boxW >> boxH >> boxX >> boxY;
+		}
+		else if (key == "FONT_ASCENT")
+			ls >> ascent;
+		else if (key == "FONT_DESCENT")
+			ls >> descent;
+		else if (key == "STARTCHAR")
+		{
+			code = -1;
+			advance = w = h = xo = yo = 0;
+		}
+		else if (key == "ENCODING")
+			ls >> code;
+		else if (key == "DWIDTH")
+			ls >> advance;
+		else if (key == "BBX")
+			ls >> w >> h >> xo >> yo;
+		else if (key == "BITMAP")
+		{
+			inBitmap = true;
+			rows.clear();
+		}
+	}
+	return !font.glyphs.empty() && font.height > 0;
+}
+
+// Reads the bytes of the first array in a font header of the GLCD format (GLCDFontCreator)
+// and unpacks its glyphs. The glyphs are stored column by column, 8 rows in a byte with
+// the top row in the lowest bit. The last byte of a column of a glyph taller than 8 rows
+// has its bits aligned to the top end (see drawSolidChar in ILI9341_due.cpp).
+static bool loadGLCD(const std::string &text, Font &font)
+{
+	size_t start = text.find("PROGMEM");
+	if (start == std::string::npos)
+		start = text.find("[]");
+	if (start == std::string::npos)
+		return false;
+	start = text.find('{', start);
+	if (start == std::string::npos)
+		return false;
+
+	std::vector<uint8_t> data;
+	for (size_t i = start + 1; i < text.size() && text[i] != '}';)
+	{
+		if (text.compare(i, 2, "//") == 0)
+			i = text.find('\n', i);
+		else if (text.compare(i, 2, "/*") == 0)
+		{
+			i = text.find("*/", i);
+			if (i != std::string::npos)
+				i += 2;
+		}
+		else if (text[i] == '\'' && i + 2 < text.size())	// 'A' or '\''
+		{
+			const bool escaped = text[i + 1] == '\\';
+			data.push_back((uint8_t)text[i + 1 + escaped]);
+			i = text.find('\'', i + 2 + escaped);
+			if (i != std::string::npos)
+				i++;
+		}
+		else if (isdigit((unsigned char)text[i]))
+		{
+			char *end;
+			data.push_back((uint8_t)strtoul(text.c_str() + i, &end, 0));
+			i = end - text.c_str();
+			continue;
+		}
+		else
+			i++;
+		if (i == std::string::npos)
+			break;
+	}
+	if (data.size() < GTEXT_FONT_WIDTH_TABLE)
+		return false;
+
+	const bool fixedWidth = data[0] == 0 && data[1] == 0;
+	if (fixedWidth && data[GTEXT_FONT_FIXED_WIDTH] == 0)
+	{
+		fprintf(stderr, "The font is an extended font already\n");
+		return false;
+	}
+	font.height = data[GTEXT_FONT_HEIGHT];
+	const uint8_t firstChar = data[GTEXT_FONT_FIRST_CHAR];
+	const uint8_t charCount = data[GTEXT_FONT_CHAR_COUNT];
+	const uint16_t heightInBytes = (font.height + 7) / 8;
+
+	size_t index = fixedWidth ? GTEXT_FONT_WIDTH_TABLE : GTEXT_FONT_WIDTH_TABLE + charCount;
+	for (uint16_t c = 0; c < charCount; c++)
+	{
+		Glyph glyph;
+		glyph.w = fixedWidth ? data[GTEXT_FONT_FIXED_WIDTH] : data[GTEXT_FONT_WIDTH_TABLE + c];
+		glyph.pixels.assign((size_t)glyph.w * font.height, 0);
+		if (index + (size_t)glyph.w * heightInBytes > data.size())
+		{
+			fprintf(stderr, "The font data ends in the middle of char %d\n", firstChar + c);
+			return false;
+		}
+		for (uint16_t i = 0; i < heightInBytes; i++)
+		{
+			for (uint16_t j = 0; j < glyph.w; j++)
+			{
+				uint8_t bits = data[index + i * glyph.w + j];
+				if (font.height > 8 && font.height < (i + 1) * 8)
+					bits >>= (i + 1) * 8 - font.height;
+				for (uint16_t b = 0; b < 8 && i * 8 + b < font.height; b++)
+					glyph.pixels[(size_t)(i * 8 + b) * glyph.w + j] = (bits >> b) & 1;
+			}
+		}
+		index += (size_t)glyph.w * heightInBytes;
+		font.glyphs[firstChar + c] = glyph;
+	}
+	return true;
+}
+
+// "32-126,176" -> the set of codes
+static bool parseRanges(const char *text, std::vector<bool> &selected)
+{
+	selected.assign(256, false);
+	while (*text)
+	{
+		char *end;
+		const long first = strtol(text, &end, 0);
+		long last = first;
+		if (end == text)
+			return false;
+		text = end;
+		if (*text == '-')
+		{
+			last = strtol(text + 1, &end, 0);
+			if (end == text + 1)
+				return false;
+			text = end;
+		}
+		if (first < 0 || last > 255 || first > last)
+			return false;
+		for (long c = first; c <= last; c++)
+			selected[c] = true;
+		if (*text == ',')
+			text++;
+		else if (*text)
+			return false;
+	}
+	return true;
+}
+
+static void write16(std::vector<uint8_t> &out, uint16_t v)
+{
+	out.push_back(v & 0xFF);
+	out.push_back(v >> 8);
+}
+
+struct Range
+{
+	uint8_t first;
+	uint16_t count;
+	uint16_t glyph;
+};
+
+// Appends a glyph in gTextGlyphRLE: each row starts with the number of identical rows it stands for,
+// then come the lengths of the runs of unset and set pixels, starting with unset ones (0 if the row starts
+// with a set pixel), until they add up to the width
+static void encodeRLE(const Glyph &glyph, uint16_t height, std::vector<uint8_t> &data)
+{
+	size_t countAt = 0;
+	for (uint16_t y = 0; y < height; y++)
+	{
+		const uint8_t *row = glyph.pixels.data() + (size_t)y * glyph.w;
+		if (y > 0 && data[countAt] < 255 && std::equal(row, row + glyph.w, row - glyph.w))
+		{
+			data[countAt]++;
+			continue;
+		}
+		countAt = data.size();
+		data.push_back(1);
+		uint8_t set = 0;
+		for (uint16_t x = 0; x < glyph.w;)
+		{
+			uint16_t length = 0;
+			while (x < glyph.w && (row[x] != 0) == (set != 0))
+			{
+				x++;
+				length++;
+			}
+			data.push_back((uint8_t)length);
+			set = !set;
+		}
+	}
+}
+
+// Builds the extended font, the codes in a row make a range
+static bool buildFont(const Font &font, uint8_t columnWidth, int encoding, std::vector<uint8_t> &out, std::vector<Range> &ranges)
+{
+	if (encoding == glyphAuto)
+	{
+		std::vector<uint8_t> rle;
+		std::vector<Range> rleRanges;
+		if (!buildFont(font, columnWidth, glyphBitmap, out, ranges) || !buildFont(font, columnWidth, glyphRLE, rle, rleRanges))
+			return false;
+		if (rle.size() < out.size())
+			out.swap(rle);
+		return true;
+	}
+
+	std::vector<uint8_t> table, data;
+	int lastCode = -2;
+	for (const auto &g : font.glyphs)
+	{
+		const Glyph &glyph = g.second;
+		if (glyph.w > 255)
+		{
+			fprintf(stderr, "Char %d is wider than 255 pixels\n", g.first);
+			return false;
+		}
+		if (g.first != lastCode + 1 || ranges.back().count == 255)
+			ranges.push_back({ (uint8_t)g.first, 0, (uint16_t)(table.size() / 4) });
+		ranges.back().count++;
+		lastCode = g.first;
+
+		const uint32_t offset = data.size();
+		if (offset > XFONT_MAX_OFFSET)
+		{
+			fprintf(stderr, "The font is too big\n");
+			return false;
+		}
+		table.push_back(glyph.w);
+		table.push_back(offset & 0xFF);
+		table.push_back((offset >> 8) & 0xFF);
+		table.push_back(offset >> 16);
+
+		if (encoding == glyphRLE)
+		{
+			encodeRLE(glyph, font.height, data);
+			continue;
+		}
+		const uint16_t bytesPerRow = (glyph.w + 7) / 8;
+		for (uint16_t y = 0; y < font.height; y++)
+		{
+			const size_t rowStart = data.size();
+			data.resize(rowStart + bytesPerRow, 0);
+			for (uint16_t x = 0; x < glyph.w; x++)
+				if (glyph.pixels[(size_t)y * glyph.w + x])
+					data[rowStart + x / 8] |= 0x80 >> (x % 8);
+		}
+	}
+	if (ranges.size() > 255)
+	{
+		fprintf(stderr, "The font has more than 255 ranges\n");
+		return false;
+	}
+
+	out = { 0, 0, 0, (uint8_t)font.height, XFONT_VERSION, (uint8_t)encoding, columnWidth, (uint8_t)ranges.size() };
+	write16(out, table.size() / 4);
+	for (const Range &r : ranges)
+	{
+		out.push_back(r.first);
+		out.push_back((uint8_t)r.count);
+		write16(out, r.glyph);
+	}
+	out.insert(out.end(), table.begin(), table.end());
+	out.insert(out.end(), data.begin(), data.end());
+	return true;
+}
+
+static bool writeHeader(const std::string &filename, const std::string &name, const std::string &source,
+	const Font &font, const std::vector<Range> &ranges, const std::vector<uint8_t> &bytes)
+{
+	FILE *f = fopen(filename.c_str(), "w");
+	if (!f)
+		return false;
+
+	std::string guard = name, rangeText;
+	for (char &c : guard)
+		c = toupper((unsigned char)c);
+	for (const Range &r : ranges)
+	{
+		char text[16];
+		if (r.count == 1)
+			snprintf(text, sizeof(text), "%d", r.first);
+		else
+			snprintf(text, sizeof(text), "%d-%d", r.first, r.first + r.count - 1);
+		rangeText += (rangeText.empty() ? "" : ",") + std::string(text);
+	}
+
+	fprintf(f, "/*\n *\n * %s\n *\n * created with ILIFontCompiler from %s\n *\n", name.c_str(), source.c_str());
+	fprintf(f, " * Font size in bytes  : %zu\n", bytes.size());
+	fprintf(f, " * Font height         : %d\n", font.height);
+	fprintf(f, " * Font chars          : %s\n", rangeText.c_str());
+	fprintf(f, " * Glyph encoding      : %s\n", bytes[5] == glyphRLE ? "RLE" : "bitmap");
+	fprintf(f, " *\n * Extended font of ILI9341_due (see GTEXT_XFONT_VERSION in ILI9341_due.h)\n */\n\n");
+	fprintf(f, "#include <inttypes.h>\n#include <avr/pgmspace.h>\n\n");
+	fprintf(f, "#ifndef %s_H\n#define %s_H\n\n", guard.c_str(), guard.c_str());
+	fprintf(f, "#define %s_HEIGHT %d\n\n", guard.c_str(), font.height);
+	fprintf(f, "static const uint8_t %s[] PROGMEM = {\n", name.c_str());
+
+	const size_t tableStart = XFONT_HEADER_SIZE + ranges.size() * 4;
+	const size_t dataStart = tableStart + font.glyphs.size() * 4;
+	fprintf(f, "    0x00, 0x00, 0x00, // extended font\n");
+	fprintf(f, "    0x%02X, // height\n", bytes[3]);
+	fprintf(f, "    0x%02X, // version\n", bytes[4]);
+	fprintf(f, "    0x%02X, // encoding\n", bytes[5]);
+	fprintf(f, "    0x%02X, // column width\n", bytes[6]);
+	fprintf(f, "    0x%02X, // range count\n", bytes[7]);
+	fprintf(f, "    0x%02X, 0x%02X, // glyph count\n", bytes[8], bytes[9]);
+	fprintf(f, "\n    // ranges");
+	for (size_t i = XFONT_HEADER_SIZE; i < tableStart; i++)
+		fprintf(f, "%s0x%02X,", (i - XFONT_HEADER_SIZE) % 4 == 0 ? "\n    " : " ", bytes[i]);
+	fprintf(f, "\n\n    // glyphs (width, offset)");
+	for (size_t i = tableStart; i < dataStart; i++)
+		fprintf(f, "%s0x%02X,", (i - tableStart) % 16 == 0 ? "\n    " : " ", bytes[i]);
+	fprintf(f, "\n\n    // glyph data");
+	for (size_t i = dataStart; i < bytes.size(); i++)
+		fprintf(f, "%s0x%02X%s", (i - dataStart) % 16 == 0 ? "\n    " : " ", bytes[i], i + 1 < bytes.size() ? "," : "");
+	fprintf(f, "\n};\n\n#endif\n");
+	return fclose(f) == 0;
+}
+
+static void usage()
+{
+	fprintf(stderr,
+		"Usage: ILIFontCompiler [-e bitmap|rle|auto] [-r ranges] [-n name] [-w column width] input.bdf|input.h output.h\n"
+		"  -e  glyph encoding, bitmap, rle (runs of pixels, identical rows stored once) or auto, the smaller one (default)\n"
+		"  -r  codes to take from the input, e.g. 32-126,176 (default: all of them up to 255)\n"
+		"  -n  name of the array (default: the name of the output file)\n"
+		"  -w  width of a column for cursorTo and setTextArea with columns (default: the widest glyph)\n");
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<bool> selected(256, true);
+	std::string name;
+	int columnWidth = -1;
+	int encoding = glyphAuto;
+	int i = 1;
+	for (; i < argc && argv[i][0] == '-'; i++)
+	{
+		const char *option = argv[i];
+		if (i + 1 < argc && strcmp(option, "-r") == 0)
+		{
+			if (!parseRanges(argv[++i], selected))
+			{
+				fprintf(stderr, "Invalid ranges: %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (i + 1 < argc && strcmp(option, "-e") == 0)
+		{
+			const char *value = argv[++i];
+			if (strcmp(value, "bitmap") == 0)
+				encoding = glyphBitmap;
+			else if (strcmp(value, "rle") == 0)
+				encoding = glyphRLE;
+			else if (strcmp(value, "auto") == 0)
+				encoding = glyphAuto;
+			else
+			{
+				fprintf(stderr, "Unknown encoding: %s\n", value);
+				return 1;
+			}
+		}
+		else if (i + 1 < argc && strcmp(option, "-n") == 0)
+			name = argv[++i];
+		else if (i + 1 < argc && strcmp(option, "-w") == 0)
+			columnWidth = atoi(argv[++i]);
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (argc - i != 2)
+	{
+		usage();
+		return 1;
+	}
+	const fs::path input = argv[i];
+	const fs::path output = argv[i + 1];
+
+	std::string text;
+	if (!readText(input.string(), text))
+	{
+		fprintf(stderr, "Cannot read %s\n", input.string().c_str());
+		return 1;
+	}
+	Font font;
+	std::string ext = input.extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	const bool loaded = ext == ".bdf" ? loadBDF(text, font) : loadGLCD(text, font);
+	if (!loaded)
+	{
+		fprintf(stderr, "Cannot read the font in %s\n", input.string().c_str());
+		return 1;
+	}
+
+	for (auto g = font.glyphs.begin(); g != font.glyphs.end();)
+		g = selected[g->first] ? std::next(g) : font.glyphs.erase(g);
+	if (font.glyphs.empty())
+	{
+		fprintf(stderr, "No chars in the ranges\n");
+		return 1;
+	}
+	if (font.height > 255)
+	{
+		fprintf(stderr, "The font is taller than 255 pixels\n");
+		return 1;
+	}
+	if (columnWidth < 0)
+	{
+		columnWidth = 0;
+		for (const auto &g : font.glyphs)
+			columnWidth = std::max<int>(columnWidth, g.second.w);
+	}
+	if (name.empty())
+		name = output.stem().string();
+
+	std::vector<uint8_t> bytes;
+	std::vector<Range> ranges;
+	if (!buildFont(font, (uint8_t)std::min(columnWidth, 255), encoding, bytes, ranges))
+		return 1;
+	if (!writeHeader(output.string(), name, input.filename().string(), font, ranges, bytes))
+	{
+		fprintf(stderr, "Cannot write %s\n", output.string().c_str());
+		return 1;
+	}
+	printf("%s: %zu chars in %zu ranges, %d pixels tall, %s, %zu bytes\n", output.string().c_str(),
+		font.glyphs.size(), ranges.size(), font.height, bytes[5] == glyphRLE ? "RLE" : "bitmap", bytes.size());
+	return 0;
+}
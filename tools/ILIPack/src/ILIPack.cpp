@@ -0,0 +1,452 @@
+/*
+ILIPack.cpp - packs BMP images into one image pack for ILI9341_due
+
+The pack starts with a hash table of the images (name hash, format, size, offset)
+followed by the pixels of each image, see iliPackEntry in ILI9341_due.h.
+A pack in flash is drawn with drawPackImage, one on an SD card is found with one
+read of the slot and drawn with one seek and sequential reads (see the
+sdFatTftBitmap example).
+
+Usage: ILIPack [-a alignment] [-f raw|rle|indexed|auto] pack.ilp|pack.h image.bmp[:format] ...
+  -a  the images start at multiples of this many bytes (default: 4, use 512 for SD cards)
+  -f  format of the images without their own (default: auto, the smallest one)
+a name ending with .h writes a PROGMEM array named after the file instead of the binary pack.
+The images are found by their file name without the extension.
+
+Code: https://github.com/marekburiak/ILI9341_due
+Documentation: http://marekburiak.github.io/ILI9341_due/
+
+Copyright (c) 2015  Marek Buriak
+
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// the same layout as in ILI9341_due.h
+#define ILI_PACK_HEADER_SIZE 12
+#define ILI_PACK_SLOT_SIZE 20
+#define ILI_PACK_VERSION 1
+enum { packRaw, packRLE, packIndexed, packAuto, packEmpty = 0xFF };
+
+#define RLE_MAX_COUNT 0x7FFF
+#define RLE_MIN_REPEAT 3	// shorter repeats are cheaper as part of a literal packet
+
+struct PackImage
+{
+	std::string name;
+	uint32_t hash;
+	uint16_t w, h;
+	uint8_t format;
+	uint8_t bitsPerPixel;
+	uint16_t paletteSize;
+	std::vector<uint8_t> data;
+	uint32_t offset;
+};
+
+uint32_t packHash(const char *name)
+{
+	uint32_t hash = 2166136261UL;
+	while (*name)
+	{
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619UL;
+	}
+	return hash;
+}
+
+inline uint16_t read16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint32_t read32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline void write16(std::vector<uint8_t> &out, uint16_t v)
+{
+	out.push_back(v & 0xFF);
+	out.push_back(v >> 8);
+}
+
+inline void write32(std::vector<uint8_t> &out, uint32_t v)
+{
+	write16(out, v & 0xFFFF);
+	write16(out, v >> 16);
+}
+
+inline uint16_t to565(uint8_t r, uint8_t g, uint8_t b)
+{
+	return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+// reads an uncompressed 24 or 32 bit BMP (bottom-up or top-down) into RGB565 pixels, top row first
+bool readBMP(const fs::path &path, std::vector<uint16_t> &pixels, uint16_t &w, uint16_t &h)
+{
+	FILE *file = fopen(path.string().c_str(), "rb");
+	if (file == NULL)
+	{
+		printf("Could not read file %s\n", path.string().c_str());
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	const long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	std::vector<uint8_t> bmp(size > 0 ? size : 0);
+	const bool read = size > 0 && fread(bmp.data(), 1, bmp.size(), file) == bmp.size();
+	fclose(file);
+
+	if (!read || bmp.size() < 54 || read16(&bmp[0]) != 0x4D42)
+	{
+		printf("%s is not a BMP file\n", path.string().c_str());
+		return false;
+	}
+	const uint32_t imageOffset = read32(&bmp[0x0A]);
+	const int32_t bmpWidth = (int32_t)read32(&bmp[0x12]);
+	const int32_t bmpHeight = (int32_t)read32(&bmp[0x16]);
+	const uint16_t depth = read16(&bmp[0x1C]);
+	const uint32_t compression = read32(&bmp[0x1E]);
+	const bool bgraFields = depth == 32 && compression == 3 && bmp.size() >= 66 &&
+		read32(&bmp[0x36]) == 0x00FF0000 && read32(&bmp[0x3A]) == 0x0000FF00 && read32(&bmp[0x3E]) == 0x000000FF;
+	if ((depth != 24 && depth != 32) || (compression != 0 && !bgraFields))
+	{
+		printf("%s is not an uncompressed 24 or 32 bit BMP\n", path.string().c_str());
+		return false;
+	}
+
+	const bool flip = bmpHeight > 0;	// stored bottom-up
+	const uint32_t width = bmpWidth, height = flip ? bmpHeight : -bmpHeight;
+	const uint32_t bytesPerPixel = depth / 8;
+	const uint32_t rowSize = (width * bytesPerPixel + 3) & ~3;
+	if (bmpWidth <= 0 || height == 0 || width > 0xFFFF || height > 0xFFFF ||
+		(uint64_t)imageOffset + (uint64_t)rowSize * height > bmp.size())
+	{
+		printf("%s has an unsupported size or is truncated\n", path.string().c_str());
+		return false;
+	}
+
+	w = width;
+	h = height;
+	pixels.resize((size_t)width * height);
+	for (uint32_t row = 0; row < height; row++)
+	{
+		const uint8_t *in = &bmp[imageOffset + (size_t)(flip ? height - 1 - row : row) * rowSize];
+		uint16_t *out = &pixels[(size_t)row * width];
+		for (uint32_t x = 0; x < width; x++, in += bytesPerPixel)
+			out[x] = to565(in[2], in[1], in[0]);
+	}
+	return true;
+}
+
+int repeatLength(const std::vector<uint16_t> &pixels, uint32_t start, int maxLength)
+{
+	const uint32_t count = (uint32_t)pixels.size();
+	int length = 1;
+	while (start + length < count && length < maxLength && pixels[start + length] == pixels[start])
+		length++;
+	return length;
+}
+
+// packets for drawImageRLE, the same encoding as BMP24toILI565 -rle
+std::vector<uint8_t> encodeRLE(const std::vector<uint16_t> &pixels)
+{
+	const uint32_t count = (uint32_t)pixels.size();
+	std::vector<uint8_t> out;
+	uint32_t p = 0;
+	while (p < count)
+	{
+		int repeat = repeatLength(pixels, p, RLE_MAX_COUNT);
+		if (repeat >= RLE_MIN_REPEAT)
+		{
+			write16(out, 0x8000 | repeat);
+			write16(out, pixels[p]);
+			p += repeat;
+			continue;
+		}
+
+		uint32_t start = p;
+		while (p < count && p - start < RLE_MAX_COUNT && repeatLength(pixels, p, RLE_MIN_REPEAT) < RLE_MIN_REPEAT)
+			p++;
+		write16(out, (uint16_t)(p - start));
+		for (uint32_t i = start; i < p; i++)
+			write16(out, pixels[i]);
+	}
+	return out;
+}
+
+// palette followed by the indexes for drawIndexedImage, false if the image has more than 256 colors
+bool encodeIndexed(const std::vector<uint16_t> &pixels, uint16_t w, uint16_t h, std::vector<uint8_t> &out,
+	uint8_t &bitsPerPixel, uint16_t &paletteSize)
+{
+	std::map<uint16_t, uint8_t> palette;
+	for (uint16_t color : pixels)
+	{
+		if (palette.count(color) == 0)
+		{
+			if (palette.size() == 256)
+				return false;
+			palette[color] = 0;
+		}
+	}
+
+	uint8_t index = 0;
+	for (auto &entry : palette)
+	{
+		entry.second = index++;
+		write16(out, entry.first);
+	}
+	paletteSize = (uint16_t)palette.size();
+	bitsPerPixel = paletteSize <= 2 ? 1 : paletteSize <= 4 ? 2 : paletteSize <= 16 ? 4 : 8;
+
+	// packed from the most significant bit, each row starts on a new byte
+	const uint32_t bytesPerRow = ((uint32_t)w * bitsPerPixel + 7) / 8;
+	for (uint32_t y = 0; y < h; y++)
+	{
+		std::vector<uint8_t> row(bytesPerRow, 0);
+		for (uint32_t x = 0; x < w; x++)
+		{
+			const uint32_t bitPos = x * bitsPerPixel;
+			row[bitPos >> 3] |= palette[pixels[(size_t)y * w + x]] << (8 - bitsPerPixel - (bitPos & 7));
+		}
+		out.insert(out.end(), row.begin(), row.end());
+	}
+	return true;
+}
+
+bool encodeImage(const fs::path &path, int format, PackImage &image)
+{
+	std::vector<uint16_t> pixels;
+	if (!readBMP(path, pixels, image.w, image.h))
+		return false;
+	image.name = path.stem().string();
+	image.hash = packHash(image.name.c_str());
+	image.bitsPerPixel = 0;
+	image.paletteSize = 0;
+
+	std::vector<uint8_t> raw;
+	for (uint16_t color : pixels)
+		write16(raw, color);
+
+	// auto takes the smallest encoding, raw wins a tie as it draws fastest
+	image.format = packRaw;
+	image.data = raw;
+	if (format == packRLE || format == packAuto)
+	{
+		std::vector<uint8_t> rle = encodeRLE(pixels);
+		if (format == packRLE || rle.size() < image.data.size())
+		{
+			image.format = packRLE;
+			image.data = rle;
+		}
+	}
+	if (format == packIndexed || format == packAuto)
+	{
+		std::vector<uint8_t> indexed;
+		uint8_t bitsPerPixel;
+		uint16_t paletteSize;
+		if (encodeIndexed(pixels, image.w, image.h, indexed, bitsPerPixel, paletteSize))
+		{
+			if (format == packIndexed || indexed.size() < image.data.size())
+			{
+				image.format = packIndexed;
+				image.data = indexed;
+				image.bitsPerPixel = bitsPerPixel;
+				image.paletteSize = paletteSize;
+			}
+		}
+		else if (format == packIndexed)
+		{
+			printf("%s has more than 256 colors, cannot be indexed\n", path.string().c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+int parseFormat(const std::string &name)
+{
+	if (name == "raw") return packRaw;
+	if (name == "rle") return packRLE;
+	if (name == "indexed") return packIndexed;
+	if (name == "auto") return packAuto;
+	return -1;
+}
+
+// lays out the header, the hash table and the aligned images
+bool buildPack(std::vector<PackImage> &images, uint32_t alignment, std::vector<uint8_t> &pack)
+{
+	// the table is kept at most half full, most images are found in the first slot
+	uint32_t slotCount = 1;
+	while (slotCount < images.size() * 2)
+		slotCount <<= 1;
+	if (slotCount > 0x8000)
+	{
+		printf("Too many images\n");
+		return false;
+	}
+
+	std::vector<int> slots(slotCount, -1);
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		uint32_t s = images[i].hash & (slotCount - 1);
+		while (slots[s] >= 0)
+		{
+			if (images[slots[s]].hash == images[i].hash)
+			{
+				printf("%s and %s have the same hash, rename one of them\n", images[slots[s]].name.c_str(), images[i].name.c_str());
+				return false;
+			}
+			s = (s + 1) & (slotCount - 1);
+		}
+		slots[s] = (int)i;
+	}
+
+	uint32_t offset = ILI_PACK_HEADER_SIZE + slotCount * ILI_PACK_SLOT_SIZE;
+	for (PackImage &image : images)
+	{
+		offset = (offset + alignment - 1) / alignment * alignment;
+		image.offset = offset;
+		offset += (uint32_t)image.data.size();
+	}
+
+	pack.clear();
+	for (const char *magic = "ILPK"; *magic; magic++)
+		pack.push_back(*magic);
+	write16(pack, ILI_PACK_VERSION);
+	write16(pack, (uint16_t)slotCount);
+	write16(pack, (uint16_t)images.size());
+	write16(pack, 0);
+	for (uint32_t s = 0; s < slotCount; s++)
+	{
+		if (slots[s] < 0)
+		{
+			write32(pack, 0);
+			pack.push_back(packEmpty);
+			pack.insert(pack.end(), ILI_PACK_SLOT_SIZE - 5, 0);
+			continue;
+		}
+		const PackImage &image = images[slots[s]];
+		write32(pack, image.hash);
+		pack.push_back(image.format);
+		pack.push_back(image.bitsPerPixel);
+		write16(pack, image.w);
+		write16(pack, image.h);
+		write16(pack, image.paletteSize);
+		write32(pack, image.offset);
+		write32(pack, (uint32_t)image.data.size());
+	}
+	for (const PackImage &image : images)
+	{
+		pack.resize(image.offset, 0);
+		pack.insert(pack.end(), image.data.begin(), image.data.end());
+	}
+	return true;
+}
+
+bool writeHeader(const fs::path &path, const std::vector<uint8_t> &pack, const std::vector<PackImage> &images)
+{
+	const std::string name = path.stem().string();
+	FILE *file = fopen(path.string().c_str(), "w");
+	if (file == NULL)
+		return false;
+
+	fprintf(file, "#if defined(__AVR__)\n    #include <avr/pgmspace.h>\n#elif defined(__arm__)\n    #define PROGMEM\n#endif\n\n");
+	fprintf(file, "// image pack for drawPackImage:");
+	for (const PackImage &image : images)
+		fprintf(file, " %s", image.name.c_str());
+	fprintf(file, "\nconst uint8_t %s[%u] PROGMEM __attribute__((aligned(4)))={\n", name.c_str(), (uint32_t)pack.size());
+	for (size_t i = 0; i < pack.size(); i++)
+	{
+		fprintf(file, "0x%02X%s", pack[i], i + 1 < pack.size() ? "," : "");
+		if (i % 32 == 31 || i + 1 == pack.size())
+			fprintf(file, "\n");
+	}
+	fprintf(file, "};\n");
+	return fclose(file) == 0;
+}
+
+bool writeBinary(const fs::path &path, const std::vector<uint8_t> &pack)
+{
+	FILE *file = fopen(path.string().c_str(), "wb");
+	if (file == NULL)
+		return false;
+	const bool written = fwrite(pack.data(), 1, pack.size(), file) == pack.size();
+	return fclose(file) == 0 && written;
+}
+
+int main(int argc, char *argv[])
+{
+	static const char *formatNames[] = { "raw", "rle", "indexed" };
+	uint32_t alignment = 4;
+	int defaultFormat = packAuto;
+	int i = 1;
+	for (; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+			alignment = (uint32_t)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+			defaultFormat = parseFormat(argv[++i]);
+		else
+			break;
+	}
+	if (i + 2 > argc || alignment == 0 || alignment % 2 != 0 || defaultFormat < 0)
+	{
+		printf("Usage: ILIPack [-a alignment] [-f raw|rle|indexed|auto] pack.ilp|pack.h image.bmp[:format] ...\n");
+		printf("  the alignment has to be a multiple of 2\n");
+		return EXIT_FAILURE;
+	}
+
+	const fs::path packPath = argv[i++];
+	std::vector<PackImage> images;
+	for (; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		int format = defaultFormat;
+		const size_t colon = arg.rfind(':');
+		if (colon != std::string::npos && parseFormat(arg.substr(colon + 1)) >= 0)
+		{
+			format = parseFormat(arg.substr(colon + 1));
+			arg.resize(colon);
+		}
+
+		PackImage image;
+		if (!encodeImage(arg, format, image))
+			return EXIT_FAILURE;
+		for (const PackImage &other : images)
+		{
+			if (other.name == image.name)
+			{
+				printf("%s is in the pack twice\n", image.name.c_str());
+				return EXIT_FAILURE;
+			}
+		}
+		printf("%s: %ux%u %s", image.name.c_str(), image.w, image.h, formatNames[image.format]);
+		if (image.format == packIndexed)
+			printf(" (%u colors, %u bits per pixel)", image.paletteSize, image.bitsPerPixel);
+		printf(", %u bytes\n", (uint32_t)image.data.size());
+		images.push_back(image);
+	}
+
+	std::vector<uint8_t> pack;
+	if (!buildPack(images, alignment, pack))
+		return EXIT_FAILURE;
+
+	const bool header = packPath.extension() == ".h";
+	if (!(header ? writeHeader(packPath, pack, images) : writeBinary(packPath, pack)))
+	{
+		printf("Could not write %s\n", packPath.string().c_str());
+		return EXIT_FAILURE;
+	}
+	printf("%s created (%u images, %u bytes)\n", packPath.string().c_str(), (uint32_t)images.size(), (uint32_t)pack.size());
+	return EXIT_SUCCESS;
+}
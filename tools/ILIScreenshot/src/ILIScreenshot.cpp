@@ -0,0 +1,580 @@
+/*
+ILIScreenshot.cpp - receives screenshots taken with ILI9341_due and saves them as PNG or PPM
+
+Reads from a serial port or from a file with a captured stream and decodes both
+the binary frames of screenshot() and the hex text of screenshotToConsole().
+The other text the sketch prints is passed through to stdout.
+
+Usage: ILIScreenshot [-b baud] [-c] [-n count] [-s WxH] input output.png|output.ppm
+  -b  baud rate of the serial port (default: 115200)
+  -c  continuous capture, the screenshots are saved as output0001.png, output0002.png,...
+  -n  stop after this many screenshots (default: 1, with -c no limit)
+  -s  size of the screenshotToConsole screenshots, they do not carry it (default: 320x240)
+input is a serial port (/dev/ttyACM0, COM3), a file or - for stdin.
+
+Code: https://github.com/marekburiak/ILI9341_due
+Documentation: http://marekburiak.github.io/ILI9341_due/
+
+Copyright (c) 2015  Marek Buriak
+
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+// the same values as in ILI9341_due.h
+#define ILI_SCREENSHOT_VERSION 1
+#define ILI_SCREENSHOT_ROW_SAME 0
+#define ILI_SCREENSHOT_ROW_RUNS 1
+enum { screenshot565, screenshot666 };
+
+#define LEGACY_START "= PIXEL DATA START ="
+
+struct Image
+{
+	uint16_t w = 0, h = 0;
+	std::vector<uint32_t> pixels;	// 0x00RRGGBB
+};
+
+// CRC-32 of zip and PNG
+static uint32_t crcTable[256];
+
+static void makeCrcTable()
+{
+	for (uint32_t n = 0; n < 256; n++)
+	{
+		uint32_t c = n;
+		for (int k = 0; k < 8; k++)
+			c = (c & 1) ? 0xEDB88320UL ^ (c >> 1) : c >> 1;
+		crcTable[n] = c;
+	}
+}
+
+static uint32_t crcUpdate(uint32_t crc, const uint8_t *data, size_t length)
+{
+	while (length--)
+		crc = crcTable[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+	return crc;
+}
+
+// the display keeps 6 bits per channel in the upper bits of each byte
+static inline uint32_t rgb666(uint8_t r, uint8_t g, uint8_t b)
+{
+	return ((uint32_t)(r | r >> 6) << 16) | ((uint32_t)(g | g >> 6) << 8) | (b | b >> 6);
+}
+
+static inline uint32_t rgb565(uint16_t c)
+{
+	const uint8_t r = (c >> 11) & 0x1F, g = (c >> 5) & 0x3F, b = c & 0x1F;
+	return ((uint32_t)(r << 3 | r >> 2) << 16) | ((uint32_t)(g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+}
+
+// Reads the stream in blocks from a serial port, a file or stdin
+class Input
+{
+public:
+	~Input()
+	{
+#ifdef _WIN32
+		if (_handle != INVALID_HANDLE_VALUE && _handle != GetStdHandle(STD_INPUT_HANDLE))
+			CloseHandle(_handle);
+#else
+		if (_fd > 0)
+			close(_fd);
+#endif
+	}
+
+	bool open(const char *name, uint32_t baud)
+	{
+#ifdef _WIN32
+		if (strcmp(name, "-") == 0)
+		{
+			_handle = GetStdHandle(STD_INPUT_HANDLE);
+			return true;
+		}
+		std::string path = name;
+		if (path.compare(0, 3, "COM") == 0)
+			path = "\\\\.\\" + path;	// COM10 and higher only open this way
+		_handle = CreateFileA(path.c_str(), GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+		if (_handle == INVALID_HANDLE_VALUE)
+			return false;
+		DCB dcb;
+		memset(&dcb, 0, sizeof(dcb));
+		dcb.DCBlength = sizeof(dcb);
+		if (GetCommState(_handle, &dcb))	// a serial port
+		{
+			dcb.BaudRate = baud;
+			dcb.ByteSize = 8;
+			dcb.Parity = NOPARITY;
+			dcb.StopBits = ONESTOPBIT;
+			dcb.fBinary = TRUE;
+			dcb.fDtrControl = DTR_CONTROL_ENABLE;
+			SetCommState(_handle, &dcb);
+			COMMTIMEOUTS timeouts;
+			memset(&timeouts, 0, sizeof(timeouts));
+			timeouts.ReadIntervalTimeout = MAXDWORD;
+			timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+			timeouts.ReadTotalTimeoutConstant = 1000;
+			SetCommTimeouts(_handle, &timeouts);
+			_isSerial = true;
+		}
+		return true;
+#else
+		if (strcmp(name, "-") == 0)
+		{
+			_fd = 0;
+			return true;
+		}
+		_fd = ::open(name, O_RDONLY | O_NOCTTY);
+		if (_fd < 0)
+			return false;
+		struct termios tio;
+		if (tcgetattr(_fd, &tio) == 0)	// a serial port
+		{
+			cfmakeraw(&tio);
+			tio.c_cflag |= CLOCAL | CREAD;
+			tio.c_cc[VMIN] = 1;
+			tio.c_cc[VTIME] = 0;
+			cfsetispeed(&tio, baudConstant(baud));
+			cfsetospeed(&tio, baudConstant(baud));
+			tcsetattr(_fd, TCSANOW, &tio);
+			tcflush(_fd, TCIFLUSH);
+			_isSerial = true;
+		}
+		return true;
+#endif
+	}
+
+	// next byte or -1 at the end of a file
+	int get()
+	{
+		if (_position == _length && !fill())
+			return -1;
+		return _buffer[_position++];
+	}
+
+	bool read(uint8_t *data, size_t length)
+	{
+		while (length > 0)
+		{
+			if (_position == _length && !fill())
+				return false;
+			const size_t n = std::min(length, _length - _position);
+			memcpy(data, _buffer + _position, n);
+			_position += n;
+			data += n;
+			length -= n;
+		}
+		return true;
+	}
+
+private:
+#ifdef _WIN32
+	HANDLE _handle = INVALID_HANDLE_VALUE;
+#else
+	int _fd = -1;
+
+	static speed_t baudConstant(uint32_t baud)
+	{
+		switch (baud)
+		{
+		case 9600: return B9600;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 230400: return B230400;
+#ifdef B460800
+		case 460800: return B460800;
+		case 921600: return B921600;
+		case 1000000: return B1000000;
+		case 2000000: return B2000000;
+#endif
+		default: return B115200;
+		}
+	}
+#endif
+	bool _isSerial = false;
+	uint8_t _buffer[4096];
+	size_t _position = 0;
+	size_t _length = 0;
+
+	bool fill()
+	{
+		for (;;)
+		{
+#ifdef _WIN32
+			DWORD n = 0;
+			if (!ReadFile(_handle, _buffer, sizeof(_buffer), &n, NULL))
+				return false;
+#else
+			ssize_t n = ::read(_fd, _buffer, sizeof(_buffer));
+			if (n < 0)
+				return false;
+#endif
+			if (n > 0)
+			{
+				_position = 0;
+				_length = n;
+				return true;
+			}
+			if (!_isSerial)
+				return false;	// end of the file, a serial port just had nothing to say
+		}
+	}
+};
+
+// Decodes a frame of screenshot() after its "ILSS". Rows that did not change are taken from previous.
+static bool decodeFrame(Input &in, Image &image, const Image &previous)
+{
+	uint8_t header[6];
+	if (!in.read(header, sizeof(header)))
+		return false;
+	uint32_t crc = crcUpdate(0xFFFFFFFFUL, header, sizeof(header));
+	const uint8_t version = header[0];
+	const uint8_t format = header[1];
+	if (version != ILI_SCREENSHOT_VERSION || format > screenshot666)
+	{
+		fprintf(stderr, "Unsupported screenshot version %d or format %d\n", version, format);
+		return false;
+	}
+	image.w = header[2] | (header[3] << 8);
+	image.h = header[4] | (header[5] << 8);
+	image.pixels.assign((size_t)image.w * image.h, 0);
+	const bool hasPrevious = previous.w == image.w && previous.h == image.h;
+	bool missedRows = false;
+
+	const uint8_t colorSize = format == screenshot565 ? 2 : 3;
+	uint8_t run[4];
+	for (uint16_t y = 0; y < image.h; y++)
+	{
+		uint32_t *row = &image.pixels[(size_t)y * image.w];
+		if (!in.read(run, 1))
+			return false;
+		crc = crcUpdate(crc, run, 1);
+		if (run[0] == ILI_SCREENSHOT_ROW_SAME)
+		{
+			if (hasPrevious)
+				std::copy_n(&previous.pixels[(size_t)y * image.w], image.w, row);
+			else
+				missedRows = true;
+			continue;
+		}
+		if (run[0] != ILI_SCREENSHOT_ROW_RUNS)
+		{
+			fprintf(stderr, "Broken screenshot frame (row %d)\n", y);
+			return false;
+		}
+		for (uint16_t x = 0; x < image.w;)
+		{
+			if (!in.read(run, 1 + colorSize))
+				return false;
+			crc = crcUpdate(crc, run, 1 + colorSize);
+			const uint16_t n = run[0] + 1;
+			if (x + n > image.w)
+			{
+				fprintf(stderr, "Broken screenshot frame (row %d)\n", y);
+				return false;
+			}
+			const uint32_t color = colorSize == 2 ? rgb565(run[1] | (run[2] << 8)) : rgb666(run[1], run[2], run[3]);
+			std::fill_n(row + x, n, color);
+			x += n;
+		}
+	}
+
+	uint8_t end[4];
+	if (!in.read(end, sizeof(end)))
+		return false;
+	const uint32_t sentCrc = end[0] | (end[1] << 8) | (end[2] << 16) | ((uint32_t)end[3] << 24);
+	if (sentCrc != ~crc)
+	{
+		fprintf(stderr, "Screenshot CRC mismatch, the frame is skipped\n");
+		return false;
+	}
+	if (missedRows)
+		fprintf(stderr, "Unchanged rows without a previous screenshot are black (the sketch's rowCrcs were not reset)\n");
+	return true;
+}
+
+static int hexValue(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
+
+static uint32_t hexNumber(const char *s, int digits)
+{
+	uint32_t v = 0;
+	while (digits--)
+		v = (v << 4) | hexValue(*s++);
+	return v;
+}
+
+// Decodes the line of screenshotToConsole: color (6 digits) and pixel count (4 digits) pairs and
+// the length of all of them (8 digits) at the end
+static bool decodeLegacy(const std::string &line, Image &image, uint16_t w, uint16_t h)
+{
+	const size_t length = line.size();
+	if (length < 8 || !std::all_of(line.begin(), line.end(), [](char c) { return hexValue(c) >= 0; }) ||
+		hexNumber(line.c_str() + length - 8, 8) != length - 8 || (length - 8) % 10 != 0)
+	{
+		fprintf(stderr, "Image data length mismatch, the screenshot is skipped\n");
+		return false;
+	}
+	image.w = w;
+	image.h = h;
+	image.pixels.assign((size_t)w * h, 0);
+	size_t p = 0;
+	for (size_t i = 0; i < length - 8; i += 10)
+	{
+		const char *s = line.c_str() + i;
+		const uint32_t color = rgb666(hexNumber(s, 2), hexNumber(s + 2, 2), hexNumber(s + 4, 2));
+		const size_t n = std::min<size_t>(hexNumber(s + 6, 4), image.pixels.size() - p);
+		std::fill_n(image.pixels.begin() + p, n, color);
+		p += n;
+	}
+	if (p != image.pixels.size())
+		fprintf(stderr, "The screenshot has %zu pixels instead of %dx%d, use -s\n", p, w, h);
+	return true;
+}
+
+static void putBE32(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static void writeChunk(FILE *f, const char *type, const uint8_t *data, uint32_t length)
+{
+	uint8_t b[4];
+	putBE32(b, length);
+	fwrite(b, 1, 4, f);
+	fwrite(type, 1, 4, f);
+	if (length)
+		fwrite(data, 1, length, f);
+	uint32_t crc = crcUpdate(0xFFFFFFFFUL, (const uint8_t*)type, 4);
+	crc = crcUpdate(crc, data, length);
+	putBE32(b, ~crc);
+	fwrite(b, 1, 4, f);
+}
+
+// PNG with stored (uncompressed) deflate blocks, no zlib needed
+static bool savePNG(const char *filename, const Image &image)
+{
+	FILE *f = fopen(filename, "wb");
+	if (!f)
+		return false;
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	fwrite(signature, 1, 8, f);
+
+	uint8_t ihdr[13];
+	putBE32(ihdr, image.w);
+	putBE32(ihdr + 4, image.h);
+	ihdr[8] = 8;	// bit depth
+	ihdr[9] = 2;	// RGB
+	ihdr[10] = ihdr[11] = ihdr[12] = 0;
+	writeChunk(f, "IHDR", ihdr, sizeof(ihdr));
+
+	std::vector<uint8_t> raw;
+	raw.reserve((1 + (size_t)image.w * 3) * image.h);
+	for (uint16_t y = 0; y < image.h; y++)
+	{
+		raw.push_back(0);	// filter: none
+		for (uint16_t x = 0; x < image.w; x++)
+		{
+			const uint32_t c = image.pixels[(size_t)y * image.w + x];
+			raw.push_back(c >> 16);
+			raw.push_back(c >> 8);
+			raw.push_back(c);
+		}
+	}
+
+	const size_t blockMax = 65535;
+	std::vector<uint8_t> z = { 0x78, 0x01 };
+	uint32_t a = 1, b = 0;
+	for (size_t offset = 0; offset < raw.size(); offset += blockMax)
+	{
+		const size_t length = std::min(raw.size() - offset, blockMax);
+		z.push_back(offset + length == raw.size() ? 1 : 0);
+		z.push_back(length & 0xFF);
+		z.push_back(length >> 8);
+		z.push_back(~length & 0xFF);
+		z.push_back((~length >> 8) & 0xFF);
+		z.insert(z.end(), raw.begin() + offset, raw.begin() + offset + length);
+		for (size_t i = offset; i < offset + length; i++)
+		{
+			a = (a + raw[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+	}
+	z.resize(z.size() + 4);
+	putBE32(&z[z.size() - 4], (b << 16) | a);
+	writeChunk(f, "IDAT", z.data(), z.size());
+	writeChunk(f, "IEND", NULL, 0);
+	return fclose(f) == 0;
+}
+
+static bool savePPM(const char *filename, const Image &image)
+{
+	FILE *f = fopen(filename, "wb");
+	if (!f)
+		return false;
+	fprintf(f, "P6\n%d %d\n255\n", image.w, image.h);
+	std::vector<uint8_t> rgb;
+	rgb.reserve((size_t)image.w * image.h * 3);
+	for (uint32_t c : image.pixels)
+	{
+		rgb.push_back(c >> 16);
+		rgb.push_back(c >> 8);
+		rgb.push_back(c);
+	}
+	fwrite(rgb.data(), 1, rgb.size(), f);
+	return fclose(f) == 0;
+}
+
+static bool saveImage(const std::string &filename, const Image &image)
+{
+	const size_t dot = filename.rfind('.');
+	if (dot != std::string::npos && filename.substr(dot) == ".ppm")
+		return savePPM(filename.c_str(), image);
+	return savePNG(filename.c_str(), image);
+}
+
+// output.png -> output0001.png
+static std::string numberedName(const std::string &output, uint32_t number)
+{
+	char digits[16];
+	snprintf(digits, sizeof(digits), "%04u", number);
+	size_t dot = output.rfind('.');
+	if (dot == std::string::npos || output.find_first_of("/\\", dot) != std::string::npos)
+		dot = output.size();
+	return output.substr(0, dot) + digits + output.substr(dot);
+}
+
+static void usage()
+{
+	fprintf(stderr,
+		"Usage: ILIScreenshot [-b baud] [-c] [-n count] [-s WxH] input output.png|output.ppm\n"
+		"  -b  baud rate of the serial port (default: 115200)\n"
+		"  -c  continuous capture, the screenshots are saved as output0001.png, output0002.png,...\n"
+		"  -n  stop after this many screenshots (default: 1, with -c no limit)\n"
+		"  -s  size of the screenshotToConsole screenshots (default: 320x240)\n"
+		"input is a serial port (/dev/ttyACM0, COM3), a file or - for stdin.\n");
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t baud = 115200;
+	bool continuous = false;
+	uint32_t maxCount = 0;
+	unsigned legacyW = 320, legacyH = 240;
+	int i = 1;
+	for (; i < argc && argv[i][0] == '-' && argv[i][1] != 0; i++)
+	{
+		const char *option = argv[i];
+		if (strcmp(option, "-c") == 0)
+			continuous = true;
+		else if (i + 1 < argc && strcmp(option, "-b") == 0)
+			baud = strtoul(argv[++i], NULL, 10);
+		else if (i + 1 < argc && strcmp(option, "-n") == 0)
+			maxCount = strtoul(argv[++i], NULL, 10);
+		else if (i + 1 < argc && strcmp(option, "-s") == 0)
+		{
+			if (sscanf(argv[++i], "%ux%u", &legacyW, &legacyH) != 2 || legacyW == 0 || legacyH == 0 || legacyW > 65535 || legacyH > 65535)
+			{
+				usage();
+				return 1;
+			}
+		}
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (argc - i != 2)
+	{
+		usage();
+		return 1;
+	}
+	const char *inputName = argv[i];
+	const std::string output = argv[i + 1];
+	if (maxCount == 0 && !continuous)
+		maxCount = 1;
+
+	makeCrcTable();
+	Input in;
+	if (!in.open(inputName, baud))
+	{
+		fprintf(stderr, "Cannot open %s\n", inputName);
+		return 1;
+	}
+
+	Image image, previous;
+	uint32_t saved = 0;
+	std::string line;
+	bool legacyData = false;	// the next line is the screenshotToConsole data
+	int c;
+	while ((maxCount == 0 || saved < maxCount) && (c = in.get()) >= 0)
+	{
+		bool decoded = false;
+		if (c == '\n')
+		{
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+			if (legacyData && !line.empty())
+			{
+				legacyData = false;
+				decoded = decodeLegacy(line, image, legacyW, legacyH);
+			}
+			else if (line.find(LEGACY_START) != std::string::npos)
+				legacyData = true;
+			else if (!legacyData)
+				printf("%s\n", line.c_str());
+			line.clear();
+		}
+		else
+		{
+			line += (char)c;
+			if (!legacyData && line.size() >= 4 && line.compare(line.size() - 4, 4, "ILSS") == 0)
+			{
+				line.resize(line.size() - 4);
+				if (!line.empty())
+					printf("%s", line.c_str());
+				line.clear();
+				decoded = decodeFrame(in, image, previous);
+			}
+		}
+		fflush(stdout);
+
+		if (decoded)
+		{
+			saved++;
+			const std::string filename = continuous ? numberedName(output, saved) : output;
+			if (!saveImage(filename, image))
+			{
+				fprintf(stderr, "Cannot write %s\n", filename.c_str());
+				return 1;
+			}
+			fprintf(stderr, "Saved %s (%dx%d)\n", filename.c_str(), image.w, image.h);
+			std::swap(previous, image);
+		}
+	}
+	return saved > 0 ? 0 : 1;
+}
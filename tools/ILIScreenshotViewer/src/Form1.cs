@@ -154,7 +154,7 @@ namespace ILIScreenshotViewer
             }
             catch (Exception ex)
             {
-                lblFailed.Text = "Failed to load the image.\nTry increasing ILI9341_SPI_CLKDIVIDER or\nchange to NORMAL or EXTENDED SPI mode.";
+                lblFailed.Text = "Failed to load the image.\nTry increasing ILI9341_SPI_CLKDIVIDER_READ or\nchange to NORMAL or EXTENDED SPI mode.";
                 textBox1.AppendText(ex.Message + "\r\n");
                 pictureBox.Image = null;
                 lblFailed.Visible = true;